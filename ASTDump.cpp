@@ -0,0 +1,308 @@
+//===-- ASTDump.cpp - AST dumps of the call sites and callees -------------===//
+
+#include "ASTDump.h"
+#include "CallSite.h"
+#include "OutputWriter.h"
+
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/Decl.h"
+#include "clang/AST/Expr.h"
+#include "clang/AST/ExprCXX.h"
+#include "clang/AST/Stmt.h"
+#include "clang/Basic/SourceManager.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+namespace clang {
+namespace showcall {
+
+namespace {
+// A node of the dumped tree: a statement, possibly null, or a declaration.
+struct DumpNode {
+  const Stmt *S;
+  const Decl *D;
+
+  DumpNode(const Stmt *S) : S(S), D(nullptr) {}
+  DumpNode(const Decl *D) : S(nullptr), D(D) {}
+};
+
+// Dumps a tree in the layout of the AST dumper: the root flush left, then
+// two characters per level ("| " or "  ") and "|-" or "`-" before each node.
+// The nodes past the limits are not visited.
+class LimitedDumper {
+public:
+  LimitedDumper(const SourceManager &SM, const ASTDumpLimits &Limits)
+      : SM(SM), Limits(Limits), Full(false) {}
+
+  std::string dump(DumpNode Root) {
+    dumpNode(Root, 0, /*IsLast=*/true);
+    if (Full)
+      Dump += "...\n";
+    return std::move(Dump);
+  }
+
+private:
+  void dumpNode(DumpNode N, unsigned Depth, bool IsLast);
+  bool addLine(unsigned Depth, bool IsLast, StringRef Text);
+  void describe(DumpNode N, raw_ostream &OS) const;
+  void printLocation(SourceLocation Loc, raw_ostream &OS) const;
+  static void getChildren(DumpNode N, SmallVectorImpl<DumpNode> &Children);
+
+  const SourceManager &SM;
+  ASTDumpLimits Limits;
+  std::string Dump;
+  // The drawing of the levels above the current node.
+  std::string Prefix;
+  // Set once the size limit is reached.
+  bool Full;
+};
+
+void LimitedDumper::dumpNode(DumpNode N, unsigned Depth, bool IsLast) {
+  std::string Text;
+  {
+    raw_string_ostream OS(Text);
+    describe(N, OS);
+  }
+  if (!addLine(Depth, IsLast, Text))
+    return;
+
+  SmallVector<DumpNode, 8> Children;
+  getChildren(N, Children);
+  if (Children.empty())
+    return;
+  size_t PrefixSize = Prefix.size();
+  if (Depth)
+    Prefix += IsLast ? "  " : "| ";
+  if (Limits.MaxDepth && Depth == Limits.MaxDepth)
+    addLine(Depth + 1, /*IsLast=*/true, "...");
+  else
+    for (size_t I = 0, E = Children.size(); I != E && !Full; ++I)
+      dumpNode(Children[I], Depth + 1, I + 1 == E);
+  Prefix.resize(PrefixSize);
+}
+
+bool LimitedDumper::addLine(unsigned Depth, bool IsLast, StringRef Text) {
+  if (Full)
+    return false;
+  size_t Size = Prefix.size() + (Depth ? 2 : 0) + Text.size() + 1;
+  if (Limits.MaxSize && Dump.size() + Size > Limits.MaxSize) {
+    Full = true;
+    return false;
+  }
+  Dump += Prefix;
+  if (Depth)
+    Dump += IsLast ? "`-" : "|-";
+  Dump.append(Text.data(), Text.size());
+  Dump += '\n';
+  return true;
+}
+
+void LimitedDumper::printLocation(SourceLocation Loc, raw_ostream &OS) const {
+  if (Loc.isInvalid())
+    return;
+  OS << " <" << SM.getExpansionLineNumber(Loc) << ':'
+     << SM.getExpansionColumnNumber(Loc) << '>';
+}
+
+void LimitedDumper::describe(DumpNode N, raw_ostream &OS) const {
+  if (const Decl *D = N.D) {
+    OS << D->getDeclKindName() << "Decl";
+    printLocation(D->getLocation(), OS);
+    if (const NamedDecl *ND = dyn_cast<NamedDecl>(D))
+      OS << ' ' << ND->getNameAsString();
+    if (const ValueDecl *VD = dyn_cast<ValueDecl>(D))
+      OS << " '" << VD->getType().getAsString() << '\'';
+    return;
+  }
+
+  const Stmt *S = N.S;
+  if (!S) {
+    OS << "<<<NULL>>>";
+    return;
+  }
+  OS << S->getStmtClassName();
+  printLocation(S->getLocStart(), OS);
+  if (const Expr *E = dyn_cast<Expr>(S))
+    OS << " '" << E->getType().getAsString() << '\'';
+  if (const DeclRefExpr *Ref = dyn_cast<DeclRefExpr>(S))
+    OS << ' ' << Ref->getDecl()->getDeclKindName() << " '"
+       << Ref->getNameInfo().getAsString() << '\'';
+  else if (const MemberExpr *Member = dyn_cast<MemberExpr>(S))
+    OS << ' ' << (Member->isArrow() ? "->" : ".")
+       << Member->getMemberNameInfo().getAsString();
+  else if (const CastExpr *Cast = dyn_cast<CastExpr>(S))
+    OS << " <" << Cast->getCastKindName() << '>';
+  else if (const BinaryOperator *BO = dyn_cast<BinaryOperator>(S))
+    OS << " '" << BinaryOperator::getOpcodeStr(BO->getOpcode()) << '\'';
+  else if (const UnaryOperator *UO = dyn_cast<UnaryOperator>(S))
+    OS << " '" << UnaryOperator::getOpcodeStr(UO->getOpcode()) << '\'';
+  else if (const IntegerLiteral *Int = dyn_cast<IntegerLiteral>(S))
+    OS << ' '
+       << Int->getValue().toString(10, Int->getType()->isSignedIntegerType());
+  else if (const CXXBoolLiteralExpr *Bool = dyn_cast<CXXBoolLiteralExpr>(S))
+    OS << (Bool->getValue() ? " true" : " false");
+  else if (const StringLiteral *Str = dyn_cast<StringLiteral>(S)) {
+    OS << ' ';
+    Str->outputString(OS);
+  }
+}
+
+void LimitedDumper::getChildren(DumpNode N,
+                                SmallVectorImpl<DumpNode> &Children) {
+  if (const Decl *D = N.D) {
+    if (const FunctionDecl *FD = dyn_cast<FunctionDecl>(D)) {
+      for (FunctionDecl::param_const_iterator I = FD->param_begin(),
+                                              E = FD->param_end();
+           I != E; ++I)
+        Children.push_back(*I);
+      if (FD->doesThisDeclarationHaveABody())
+        Children.push_back(FD->getBody());
+    } else if (const VarDecl *VD = dyn_cast<VarDecl>(D)) {
+      if (const Expr *Init = VD->getInit())
+        Children.push_back(Init);
+    } else if (const DeclContext *DC = dyn_cast<DeclContext>(D)) {
+      for (const Decl *Child : DC->decls())
+        Children.push_back(Child);
+    }
+    return;
+  }
+
+  if (!N.S)
+    return;
+  if (const DeclStmt *DS = dyn_cast<DeclStmt>(N.S)) {
+    for (const Decl *Child : DS->decls())
+      Children.push_back(Child);
+    return;
+  }
+  for (Stmt::child_range C = const_cast<Stmt *>(N.S)->children(); C; ++C)
+    Children.push_back(*C);
+}
+
+bool hasLimits(const ASTDumpLimits &Limits) {
+  return Limits.MaxDepth || Limits.MaxSize;
+}
+} // end anonymous namespace
+
+std::string dumpAST(const Stmt *S, const SourceManager &SM,
+                    const ASTDumpLimits &Limits) {
+  if (hasLimits(Limits))
+    return LimitedDumper(SM, Limits).dump(S);
+  std::string Dump;
+  raw_string_ostream OS(Dump);
+  S->dump(OS, const_cast<SourceManager &>(SM));
+  return OS.str();
+}
+
+std::string dumpAST(const Decl *D, const ASTDumpLimits &Limits) {
+  if (hasLimits(Limits))
+    return LimitedDumper(D->getASTContext().getSourceManager(), Limits)
+        .dump(D);
+  std::string Dump;
+  raw_string_ostream OS(Dump);
+  D->dump(OS);
+  return OS.str();
+}
+
+bool DumpedCallees::claim(StringRef Key) {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  return Claimed.insert(Key.str()).second;
+}
+
+ASTDumpFile::ASTDumpFile(raw_ostream &OS, Format F)
+    : OS(OS), F(F), QueuedBytes(0), Finishing(false),
+      Thread(&ASTDumpFile::run, this) {}
+
+ASTDumpFile::~ASTDumpFile() { finish(); }
+
+void ASTDumpFile::addCall(const CallSite &Site, StringRef Key,
+                          std::string Dump) {
+  Entry E;
+  E.IsCall = true;
+  E.CallText = Site.CallText;
+  E.FileName = Site.FileName;
+  E.Line = Site.Line;
+  E.Column = Site.Column;
+  E.Key = Key;
+  E.Dump = std::move(Dump);
+  push(std::move(E));
+}
+
+void ASTDumpFile::addCallee(StringRef Key, std::string Dump) {
+  Entry E;
+  E.Key = Key;
+  E.Dump = std::move(Dump);
+  push(std::move(E));
+}
+
+void ASTDumpFile::push(Entry E) {
+  {
+    std::unique_lock<std::mutex> Lock(Mutex);
+    // The dumps may come faster than they are written.
+    Drained.wait(Lock, [&] { return QueuedBytes < MaxQueuedBytes; });
+    QueuedBytes += E.Dump.size();
+    Queue.push_back(std::move(E));
+  }
+  Changed.notify_one();
+}
+
+void ASTDumpFile::finish() {
+  if (!Thread.joinable())
+    return;
+  {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    Finishing = true;
+  }
+  Changed.notify_one();
+  Thread.join();
+}
+
+void ASTDumpFile::run() {
+  std::unique_lock<std::mutex> Lock(Mutex);
+  while (true) {
+    Changed.wait(Lock, [&] { return !Queue.empty() || Finishing; });
+    if (Queue.empty())
+      break;
+    std::vector<Entry> Entries;
+    Entries.swap(Queue);
+    Lock.unlock();
+    for (const Entry &E : Entries)
+      write(E);
+    Lock.lock();
+    for (const Entry &E : Entries)
+      QueuedBytes -= E.Dump.size();
+    Drained.notify_all();
+  }
+  Lock.unlock();
+  OS.flush();
+}
+
+void ASTDumpFile::write(const Entry &E) {
+  if (F == ADF_JSON) {
+    if (E.IsCall) {
+      OS << "{\"kind\":\"call\",\"call\":";
+      writeJSONString(OS, E.CallText);
+      OS << ",\"file\":";
+      writeJSONString(OS, E.FileName);
+      OS << ",\"line\":" << E.Line << ",\"column\":" << E.Column
+         << ",\"callee\":";
+    } else {
+      OS << "{\"kind\":\"callee\",\"callee\":";
+    }
+    writeJSONString(OS, E.Key);
+    OS << ",\"ast\":";
+    writeJSONString(OS, E.Dump);
+    OS << "}\n";
+    return;
+  }
+  if (E.IsCall)
+    OS << "Call site: " << E.CallText << " @ " << E.FileName << ':' << E.Line
+       << ':' << E.Column << '\n';
+  else
+    OS << "Callee: " << E.Key << '\n';
+  OS << E.Dump << '\n';
+}
+
+} // end namespace showcall
+} // end namespace clang
@@ -0,0 +1,140 @@
+//===-- ASTDump.h - AST dumps of the call sites and callees -----*- C++ -*-===//
+//
+// The dumps of --show-call-ast and --show-callee-ast can dwarf the rest of
+// the output: the same callee is dumped again for each of its calls, and the
+// dump of a call holds its whole argument tree. Each callee is dumped once
+// per run, dumps may be limited in depth and size, and they may be sent to a
+// file of their own.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SHOW_CALL_ASTDUMP_H
+#define SHOW_CALL_ASTDUMP_H
+
+#include "llvm/ADT/StringRef.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace llvm {
+class raw_ostream;
+}
+
+namespace clang {
+class Decl;
+class SourceManager;
+class Stmt;
+
+namespace showcall {
+
+struct CallSite;
+
+/// \brief How much of an AST dump to keep. 0 means no limit.
+struct ASTDumpLimits {
+  /// The deepest node kept, the dumped node itself being at depth 0.
+  unsigned MaxDepth;
+  /// In bytes; the dump is cut at the end of a line.
+  size_t MaxSize;
+
+  ASTDumpLimits() : MaxDepth(0), MaxSize(0) {}
+};
+
+/// \brief Returns the dump of \p S, within \p Limits.
+///
+/// Without limits, this is the dump of Stmt::dump. With limits, the nodes
+/// past them are not even visited: the dump is then written by show-call,
+/// in the same tree layout, with one line per node telling its class, its
+/// type and the name it refers to, and "..." in place of the nodes left
+/// out.
+std::string dumpAST(const Stmt *S, const SourceManager &SM,
+                    const ASTDumpLimits &Limits);
+
+/// \brief Same for the declaration \p D, see Decl::dump.
+std::string dumpAST(const Decl *D, const ASTDumpLimits &Limits);
+
+/// \brief The callees dumped in a run, shared by all its threads, so that
+/// each callee is dumped once.
+class DumpedCallees {
+public:
+  /// \brief Returns true the first time it is called for the callee of
+  /// this \p Key (see CallRecord::getCalleeKey), and false afterwards: the
+  /// callee is then already dumped, or about to be.
+  bool claim(llvm::StringRef Key);
+
+private:
+  std::mutex Mutex;
+  std::unordered_set<std::string> Claimed;
+};
+
+/// \brief The file receiving the AST dumps instead of the call records.
+///
+/// The dumps are formatted and written by a thread of its own, in the order
+/// they were added, so that the threads parsing the translation units only
+/// hand them over. All the methods but finish() may be called from several
+/// threads.
+class ASTDumpFile {
+public:
+  enum Format {
+    ADF_Text, ///< Each dump after a line telling what it is.
+    ADF_JSON  ///< One JSON object per dump, the dump being a string field.
+  };
+
+  ASTDumpFile(llvm::raw_ostream &OS, Format F);
+  /// \brief Calls finish().
+  ~ASTDumpFile();
+
+  /// \brief Queues the dump of the call \p Site, to the callee of this
+  /// \p Key.
+  void addCall(const CallSite &Site, llvm::StringRef Key, std::string Dump);
+
+  /// \brief Queues the dump of the callee of this \p Key.
+  void addCallee(llvm::StringRef Key, std::string Dump);
+
+  /// \brief Waits until every dump is written.
+  void finish();
+
+private:
+  ASTDumpFile(const ASTDumpFile &) = delete;
+  void operator=(const ASTDumpFile &) = delete;
+
+  /// The adders wait while this many bytes of dumps are queued.
+  enum { MaxQueuedBytes = 16 << 20 };
+
+  struct Entry {
+    /// The dump of a call, or else of a callee.
+    bool IsCall;
+    /// The call site of a call.
+    std::string CallText;
+    std::string FileName;
+    unsigned Line;
+    unsigned Column;
+    std::string Key;
+    std::string Dump;
+
+    Entry() : IsCall(false), Line(0), Column(0) {}
+  };
+
+  void push(Entry E);
+  void write(const Entry &E);
+  void run();
+
+  llvm::raw_ostream &OS;
+  Format F;
+  std::mutex Mutex;
+  std::condition_variable Changed;
+  std::condition_variable Drained;
+  std::vector<Entry> Queue;
+  size_t QueuedBytes;
+  bool Finishing;
+  std::thread Thread;
+};
+
+} // end namespace showcall
+} // end namespace clang
+
+#endif // SHOW_CALL_ASTDUMP_H
@@ -0,0 +1,257 @@
+//===-- Annotations.cpp - The --annotate edits of a run -------------------===//
+
+#include "Annotations.h"
+#include "ChangedFiles.h"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#ifdef LLVM_ON_UNIX
+#include <cerrno>
+#include <sys/stat.h>
+#endif
+
+using namespace clang::tooling;
+using namespace llvm;
+
+namespace clang {
+namespace showcall {
+
+namespace {
+// Gives the file open as FD the permissions Perms, which the umask applied
+// by createUniqueFile may have narrowed.
+std::error_code setPermissions(int FD, sys::fs::perms Perms) {
+#ifdef LLVM_ON_UNIX
+  if (::fchmod(FD, Perms) != 0)
+    return std::error_code(errno, std::generic_category());
+#endif
+  return std::error_code();
+}
+} // end anonymous namespace
+
+unsigned AnnotationSet::intern(StringRef Text) {
+  auto Inserted = TextIndex.insert(std::make_pair(Text, Texts.size()));
+  if (Inserted.second)
+    Texts.push_back(Inserted.first->getKey());
+  return Inserted.first->getValue();
+}
+
+void AnnotationSet::compact(FileEdits &File, bool Force) {
+  EditList &Edits = File.Edits;
+  size_t Appended = Edits.size() - File.SortedSize;
+  if (!Appended || (!Force && Appended < std::max<size_t>(File.SortedSize, 64)))
+    return;
+  EditList::iterator Middle = Edits.begin() + File.SortedSize;
+  std::sort(Middle, Edits.end());
+  std::inplace_merge(Edits.begin(), Middle, Edits.end());
+  Edits.erase(std::unique(Edits.begin(), Edits.end()), Edits.end());
+  File.SortedSize = Edits.size();
+}
+
+AnnotationSet::EditList AnnotationSet::getSorted(const FileEdits &File) {
+  FileEdits Copy(File);
+  compact(Copy, /*Force=*/true);
+  return std::move(Copy.Edits);
+}
+
+std::vector<StringRef> AnnotationSet::getSortedPaths() const {
+  std::vector<StringRef> Paths;
+  Paths.reserve(Files.size());
+  for (const auto &File : Files)
+    Paths.push_back(File.getKey());
+  std::sort(Paths.begin(), Paths.end());
+  return Paths;
+}
+
+void AnnotationSet::insert(const Replacement &R) {
+  Edit E = {R.getOffset(), R.getLength(), intern(R.getReplacementText())};
+  FileEdits &File = Files[R.getFilePath()];
+  File.Edits.push_back(E);
+  compact(File, /*Force=*/false);
+}
+
+void AnnotationSet::merge(const AnnotationSet &Other) {
+  // The texts of Other get new indices here.
+  std::vector<unsigned> Remap;
+  Remap.reserve(Other.Texts.size());
+  for (StringRef Text : Other.Texts)
+    Remap.push_back(intern(Text));
+
+  for (const auto &OtherFile : Other.Files) {
+    FileEdits &File = Files[OtherFile.getKey()];
+    for (const Edit &E : OtherFile.getValue().Edits) {
+      Edit Remapped = {E.Offset, E.Length, Remap[E.Text]};
+      File.Edits.push_back(Remapped);
+    }
+    compact(File, /*Force=*/false);
+  }
+}
+
+std::vector<std::string> AnnotationSet::getFiles() const {
+  std::vector<std::string> Paths;
+  for (StringRef Path : getSortedPaths())
+    Paths.push_back(Path);
+  return Paths;
+}
+
+std::vector<Replacement> AnnotationSet::getAllReplacements() const {
+  std::vector<Replacement> Result;
+  for (StringRef Path : getSortedPaths())
+    for (const Edit &E : getSorted(Files.find(Path)->getValue()))
+      Result.push_back(Replacement(Path, E.Offset, E.Length, Texts[E.Text]));
+  return Result;
+}
+
+bool AnnotationSet::applyToFile(StringRef FilePath, StringRef OutputPath,
+                                unsigned &Conflicts,
+                                std::string &Error) const {
+  StringMap<FileEdits>::const_iterator File = Files.find(FilePath);
+  if (File == Files.end())
+    return true;
+
+  // Mapped rather than read: the new contents are built in a string anyway.
+  ErrorOr<std::unique_ptr<MemoryBuffer>> Buffer = MemoryBuffer::getFile(
+      FilePath, /*FileSize=*/-1, /*RequiresNullTerminator=*/false);
+  if (!Buffer) {
+    Error = Buffer.getError().message();
+    return false;
+  }
+  StringRef Contents = (*Buffer)->getBuffer();
+
+  // Which of two conflicting edits is kept must not depend on the order the
+  // texts were interned in, which varies with -j.
+  EditList Edits = getSorted(File->getValue());
+  std::stable_sort(Edits.begin(), Edits.end(),
+                   [&](const Edit &A, const Edit &B) {
+    if (A.Offset != B.Offset || A.Length != B.Length)
+      return A < B;
+    return Texts[A.Text] < Texts[B.Text];
+  });
+
+  std::string Result;
+  Result.reserve(Contents.size() + Edits.size() * 64);
+  size_t Copied = 0;
+  for (const Edit &E : Edits) {
+    if (E.Offset < Copied) {
+      ++Conflicts;
+      continue;
+    }
+    if (E.Offset + size_t(E.Length) > Contents.size()) {
+      Error = "edits past the end of the file, which may have changed";
+      return false;
+    }
+    Result.append(Contents.data() + Copied, E.Offset - Copied);
+    Result.append(Texts[E.Text].data(), Texts[E.Text].size());
+    Copied = E.Offset + size_t(E.Length);
+  }
+  Result.append(Contents.data() + Copied, Contents.size() - Copied);
+
+  // The rename replaces the target of a symbolic link, not the link, and
+  // the new file keeps the permissions of the source.
+  std::string Target = OutputPath;
+  if (sys::fs::exists(OutputPath))
+    Target = getCanonicalPath(OutputPath);
+  sys::fs::file_status Status;
+  if (std::error_code EC = sys::fs::status(FilePath, Status)) {
+    Error = EC.message();
+    return false;
+  }
+  SmallString<256> Model(Target);
+  Model += "-%%%%%%.tmp";
+  int FD;
+  SmallString<256> TempPath;
+  if (std::error_code EC = sys::fs::createUniqueFile(Model, FD, TempPath,
+                                                     Status.permissions())) {
+    Error = EC.message();
+    return false;
+  }
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    if (std::error_code EC = setPermissions(FD, Status.permissions())) {
+      OS.close();
+      sys::fs::remove(TempPath.str());
+      Error = EC.message();
+      return false;
+    }
+    OS << Result;
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      sys::fs::remove(TempPath.str());
+      Error = "write error";
+      return false;
+    }
+  }
+  if (std::error_code EC = sys::fs::rename(TempPath.str(), Target)) {
+    sys::fs::remove(TempPath.str());
+    Error = EC.message();
+    return false;
+  }
+  return true;
+}
+
+bool saveAnnotations(const AnnotationSet &Annotations, StringRef OutputDir,
+                     unsigned Jobs) {
+  std::vector<std::string> Paths = Annotations.getFiles();
+  std::atomic<size_t> Next(0);
+  std::atomic<unsigned> Conflicts(0);
+  std::mutex ErrorMutex;
+  bool Success = true;
+
+  // Files are independent of each other: each worker takes the next one.
+  auto Worker = [&] {
+    for (size_t I = Next++; I < Paths.size(); I = Next++) {
+      const std::string &Path = Paths[I];
+      SmallString<256> OutputPath(Path);
+      std::string Error;
+      if (!OutputDir.empty()) {
+        OutputPath = OutputDir;
+        sys::path::append(OutputPath, sys::path::relative_path(Path));
+        if (std::error_code EC = sys::fs::create_directories(
+                sys::path::parent_path(OutputPath)))
+          Error = EC.message();
+      }
+      unsigned FileConflicts = 0;
+      if (Error.empty() &&
+          Annotations.applyToFile(Path, OutputPath, FileConflicts, Error)) {
+        Conflicts += FileConflicts;
+        continue;
+      }
+      std::lock_guard<std::mutex> Lock(ErrorMutex);
+      llvm::errs() << "error: cannot annotate " << Path << ": " << Error
+                   << ".\n";
+      Success = false;
+    }
+  };
+
+  if (Jobs == 0)
+    Jobs = std::max(1u, std::thread::hardware_concurrency());
+  size_t NumThreads =
+      std::max<size_t>(1, std::min<size_t>(Jobs, Paths.size()));
+  if (NumThreads == 1) {
+    Worker();
+  } else {
+    std::vector<std::thread> Threads;
+    for (size_t I = 0; I < NumThreads; ++I)
+      Threads.emplace_back(Worker);
+    for (std::thread &T : Threads)
+      T.join();
+  }
+
+  if (Conflicts)
+    llvm::errs() << "warning: skipped " << Conflicts
+                 << " annotations conflicting with another one.\n";
+  return Success;
+}
+
+} // end namespace showcall
+} // end namespace clang
@@ -0,0 +1,119 @@
+//===-- Annotations.h - The --annotate edits of a run -----------*- C++ -*-===//
+//
+// A run over a big project collects an edit per call site. As Replacements,
+// each of them holds its own copy of the file path and of the comment, which
+// mostly repeat: the same headers, the same few callees. AnnotationSet keeps
+// each path once, each distinct text once, and the edits of a file as a
+// vector of small entries, appended as they come and sorted in batches.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SHOW_CALL_ANNOTATIONS_H
+#define SHOW_CALL_ANNOTATIONS_H
+
+#include "clang/Tooling/Refactoring.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <string>
+#include <vector>
+
+namespace clang {
+namespace showcall {
+
+/// \brief A set of edits, like tooling::Replacements, stored compactly.
+class AnnotationSet {
+public:
+  AnnotationSet() {}
+
+  /// \brief Adds \p R, unless the set already holds the same edit.
+  void insert(const tooling::Replacement &R);
+
+  /// \brief Adds all the edits of \p Other, e.g. the annotations of another
+  /// translation unit.
+  void merge(const AnnotationSet &Other);
+
+  bool empty() const { return Files.empty(); }
+
+  /// \brief Returns the files with edits, in path order.
+  std::vector<std::string> getFiles() const;
+
+  /// \brief Returns all the edits, file after file.
+  std::vector<tooling::Replacement> getAllReplacements() const;
+
+  /// \brief Applies the edits of \p FilePath to its contents, in a single
+  /// pass in memory, and writes the result to \p OutputPath.
+  ///
+  /// The result goes to a temporary file renamed over \p OutputPath, so
+  /// that nobody ever sees a half written file. It gets the permissions of
+  /// \p FilePath, and when \p OutputPath is a symbolic link, replaces the
+  /// file the link points to, leaving the link in place. An edit overlapping an
+  /// earlier one, e.g. another comment for the same call in a header from
+  /// another translation unit, is dropped and counted in \p Conflicts.
+  ///
+  /// \returns false, with the reason in \p Error, if the file cannot be
+  /// read or written, or if the edits do not fit its contents.
+  bool applyToFile(llvm::StringRef FilePath, llvm::StringRef OutputPath,
+                   unsigned &Conflicts, std::string &Error) const;
+
+private:
+  struct Edit {
+    unsigned Offset;
+    unsigned Length;
+    /// Index in Texts.
+    unsigned Text;
+
+    bool operator<(const Edit &RHS) const {
+      if (Offset != RHS.Offset)
+        return Offset < RHS.Offset;
+      if (Length != RHS.Length)
+        return Length < RHS.Length;
+      return Text < RHS.Text;
+    }
+    bool operator==(const Edit &RHS) const {
+      return Offset == RHS.Offset && Length == RHS.Length && Text == RHS.Text;
+    }
+  };
+  typedef std::vector<Edit> EditList;
+
+  /// The edits of a file: the first SortedSize are sorted, without
+  /// duplicates, and the others appended since.
+  struct FileEdits {
+    EditList Edits;
+    size_t SortedSize;
+
+    FileEdits() : SortedSize(0) {}
+  };
+
+  unsigned intern(llvm::StringRef Text);
+  /// Sorts the appended edits into the others once they are as many,
+  /// which keeps the duplicates in check at one sort per doubling.
+  static void compact(FileEdits &File, bool Force);
+  /// Returns the edits of \p File, sorted, without duplicates.
+  static EditList getSorted(const FileEdits &File);
+  /// Returns the paths of Files, sorted.
+  std::vector<llvm::StringRef> getSortedPaths() const;
+
+  /// Looked up by StringRef: a path is only copied the first time.
+  llvm::StringMap<FileEdits> Files;
+  /// The keys of TextIndex, which do not move once inserted.
+  std::vector<llvm::StringRef> Texts;
+  llvm::StringMap<unsigned> TextIndex;
+};
+
+/// \brief Applies \p Annotations to each of their files, up to \p Jobs files
+/// at a time (0 means one per hardware thread).
+///
+/// Files are annotated in place, or when \p OutputDir is not empty, copied
+/// there with their absolute path, e.g. OutputDir/usr/src/a.cpp for
+/// /usr/src/a.cpp, leaving the sources untouched. Problems are reported to
+/// stderr.
+///
+/// \returns false if any of the files could not be annotated.
+bool saveAnnotations(const AnnotationSet &Annotations,
+                     llvm::StringRef OutputDir, unsigned Jobs);
+
+} // end namespace showcall
+} // end namespace clang
+
+#endif // SHOW_CALL_ANNOTATIONS_H
@@ -0,0 +1,329 @@
+//===-- BinaryOutput.cpp - Compact binary output format -------------------===//
+//
+// All integers are little endian. A binary output is made of:
+//
+//   header   "scbin001"
+//   records  u32 file, u32 line, u32 column, u32 callee, u32 kind (bits 0-1:
+//            0 function, 1 member, 2 operator) and flags (bit 8: in the main
+//            file, bit 9: defaulted callee); one per call site, in output
+//            order
+//   files    u32 offset, u32 length of each file name
+//   callees  u32 name offset, u32 name length, u32 description offset,
+//            u32 description length, u32 first posting, u32 number of
+//            postings
+//   postings u32 record numbers, the call sites of each callee in turn
+//   strings  the names
+//   footer   u64 number of records, u32 number of files, u32 number of
+//            callees, u64 offsets of the files, the callees, the postings
+//            and the strings, u64 size of the strings, "scbinend"
+//
+// String offsets are relative to the start of the strings; the footer
+// offsets to the start of the file. Records are written as they come, the
+// rest once all of them are known.
+//
+//===----------------------------------------------------------------------===//
+
+#include "BinaryOutput.h"
+#include "CallRecord.h"
+#include "OutputWriter.h"
+
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+using namespace llvm;
+
+namespace clang {
+namespace showcall {
+
+namespace {
+const char HeaderMagic[] = "scbin001";
+const char FooterMagic[] = "scbinend";
+const size_t HeaderSize = 8;
+const size_t RecordSize = 5 * 4;
+const size_t FileEntrySize = 2 * 4;
+const size_t CalleeEntrySize = 6 * 4;
+const size_t FooterSize = 8 + 4 + 4 + 5 * 8 + 8;
+
+enum {
+  KindMask = 3,
+  InMainFileFlag = 1 << 8,
+  DefaultedFlag = 1 << 9
+};
+
+const char *const KindNames[] = { "Function", "Member", "Operator" };
+
+void writeU32(raw_ostream &OS, uint32_t V) {
+  char Bytes[4] = { char(V), char(V >> 8), char(V >> 16), char(V >> 24) };
+  OS.write(Bytes, 4);
+}
+
+void writeU64(raw_ostream &OS, uint64_t V) {
+  writeU32(OS, uint32_t(V));
+  writeU32(OS, uint32_t(V >> 32));
+}
+
+uint32_t readU32(const char *P) {
+  const unsigned char *U = reinterpret_cast<const unsigned char *>(P);
+  return uint32_t(U[0]) | uint32_t(U[1]) << 8 | uint32_t(U[2]) << 16 |
+         uint32_t(U[3]) << 24;
+}
+
+uint64_t readU64(const char *P) {
+  return uint64_t(readU32(P)) | uint64_t(readU32(P + 4)) << 32;
+}
+
+class BinaryWriter : public OutputWriter {
+public:
+  explicit BinaryWriter(raw_ostream &OS) : OutputWriter(OS), NumRecords(0) {}
+
+  void writeHeader() override { OS.write(HeaderMagic, 8); }
+
+  void write(const CallRecord &R) override {
+    if (NumRecords == std::numeric_limits<uint32_t>::max())
+      report_fatal_error("Too many call sites for --format=binary.");
+    uint32_t Callee = getCallee(R);
+    Callees[Callee].Postings.push_back(uint32_t(NumRecords++));
+
+    uint32_t Kind = 0;
+    if (std::strcmp(R.Kind, "Member") == 0)
+      Kind = 1;
+    else if (std::strcmp(R.Kind, "Operator") == 0)
+      Kind = 2;
+    if (R.InMainFile)
+      Kind |= InMainFileFlag;
+    if (R.CalleeDefaulted)
+      Kind |= DefaultedFlag;
+
+    writeU32(OS, getFile(R.FileName));
+    writeU32(OS, R.Line);
+    writeU32(OS, R.Column);
+    writeU32(OS, Callee);
+    writeU32(OS, Kind);
+  }
+
+  void writeFooter() override {
+    uint64_t FilesOffset = HeaderSize + NumRecords * RecordSize;
+    for (const StringEntry &File : Files) {
+      writeU32(OS, File.Offset);
+      writeU32(OS, File.Length);
+    }
+
+    uint64_t CalleesOffset = FilesOffset + Files.size() * FileEntrySize;
+    uint32_t FirstPosting = 0;
+    for (const CalleeEntry &Callee : Callees) {
+      writeU32(OS, Callee.Name.Offset);
+      writeU32(OS, Callee.Name.Length);
+      writeU32(OS, Callee.Description.Offset);
+      writeU32(OS, Callee.Description.Length);
+      writeU32(OS, FirstPosting);
+      writeU32(OS, Callee.Postings.size());
+      FirstPosting += Callee.Postings.size();
+    }
+
+    uint64_t PostingsOffset = CalleesOffset + Callees.size() * CalleeEntrySize;
+    for (const CalleeEntry &Callee : Callees)
+      for (uint32_t Record : Callee.Postings)
+        writeU32(OS, Record);
+
+    uint64_t StringsOffset = PostingsOffset + uint64_t(FirstPosting) * 4;
+    OS << Strings;
+
+    writeU64(OS, NumRecords);
+    writeU32(OS, Files.size());
+    writeU32(OS, Callees.size());
+    writeU64(OS, FilesOffset);
+    writeU64(OS, CalleesOffset);
+    writeU64(OS, PostingsOffset);
+    writeU64(OS, StringsOffset);
+    writeU64(OS, Strings.size());
+    OS.write(FooterMagic, 8);
+  }
+
+private:
+  struct StringEntry {
+    uint32_t Offset;
+    uint32_t Length;
+  };
+  struct CalleeEntry {
+    StringEntry Name;
+    StringEntry Description;
+    std::vector<uint32_t> Postings;
+  };
+
+  StringEntry addString(StringRef S) {
+    if (Strings.size() + S.size() > std::numeric_limits<uint32_t>::max())
+      report_fatal_error("Too many names for --format=binary.");
+    StringEntry Entry = { uint32_t(Strings.size()), uint32_t(S.size()) };
+    Strings.append(S.data(), S.size());
+    return Entry;
+  }
+
+  uint32_t getFile(const std::string &FileName) {
+    auto Inserted = FileIDs.insert(std::make_pair(FileName, Files.size()));
+    if (Inserted.second)
+      Files.push_back(addString(FileName));
+    return Inserted.first->second;
+  }
+
+  uint32_t getCallee(const CallRecord &R) {
+    auto Inserted =
+        CalleeIDs.insert(std::make_pair(R.getCalleeKey(), Callees.size()));
+    if (Inserted.second) {
+      Callees.push_back(CalleeEntry());
+      Callees.back().Name = addString(R.CalleeName);
+      Callees.back().Description = addString(R.getCalleeDescription());
+    }
+    return Inserted.first->second;
+  }
+
+  uint64_t NumRecords;
+  std::string Strings;
+  std::vector<StringEntry> Files;
+  std::unordered_map<std::string, uint32_t> FileIDs;
+  std::vector<CalleeEntry> Callees;
+  /// Keyed by CallRecord::getCalleeKey: overloads share their name, and
+  /// defaulted functions their description.
+  std::unordered_map<std::string, uint32_t> CalleeIDs;
+};
+} // end anonymous namespace
+
+std::unique_ptr<OutputWriter> createBinaryWriter(raw_ostream &OS) {
+  return std::unique_ptr<OutputWriter>(new BinaryWriter(OS));
+}
+
+std::unique_ptr<BinaryCallFile> BinaryCallFile::open(StringRef FileName,
+                                                     std::string &Error) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> Buffer = MemoryBuffer::getFile(
+      FileName, /*FileSize=*/-1, /*RequiresNullTerminator=*/false);
+  if (!Buffer) {
+    Error = Buffer.getError().message();
+    return nullptr;
+  }
+  std::unique_ptr<BinaryCallFile> File(new BinaryCallFile(std::move(*Buffer)));
+  if (!File->readTables(Error))
+    return nullptr;
+  return File;
+}
+
+bool BinaryCallFile::readTables(std::string &Error) {
+  Error = "not a binary show-call output";
+  StringRef Data = Buffer->getBuffer();
+  if (Data.size() < HeaderSize + FooterSize ||
+      !Data.startswith(StringRef(HeaderMagic, 8)) ||
+      !Data.endswith(StringRef(FooterMagic, 8)))
+    return false;
+
+  const char *Footer = Data.end() - FooterSize;
+  NumRecords = readU64(Footer);
+  NumFiles = readU32(Footer + 8);
+  NumCallees = readU32(Footer + 12);
+  uint64_t FilesOffset = readU64(Footer + 16);
+  uint64_t CalleesOffset = readU64(Footer + 24);
+  uint64_t PostingsOffset = readU64(Footer + 32);
+  uint64_t StringsOffset = readU64(Footer + 40);
+  uint64_t StringsSize = readU64(Footer + 48);
+
+  // The sections follow each other, the sizes telling where each ends.
+  uint64_t Size = Data.size() - FooterSize;
+  if (NumRecords > Size / RecordSize ||
+      FilesOffset != HeaderSize + NumRecords * RecordSize ||
+      CalleesOffset != FilesOffset + uint64_t(NumFiles) * FileEntrySize ||
+      PostingsOffset !=
+          CalleesOffset + uint64_t(NumCallees) * CalleeEntrySize ||
+      StringsOffset < PostingsOffset || StringsOffset > Size ||
+      (StringsOffset - PostingsOffset) % 4 != 0 ||
+      StringsOffset + StringsSize != Size)
+    return false;
+
+  Records = Data.data() + HeaderSize;
+  Files = Data.data() + FilesOffset;
+  Callees = Data.data() + CalleesOffset;
+  Postings = Data.data() + PostingsOffset;
+  NumPostings = (StringsOffset - PostingsOffset) / 4;
+  Strings = Data.substr(StringsOffset, StringsSize);
+
+  for (uint32_t I = 0; I != NumFiles; ++I)
+    if (uint64_t(readU32(Files + I * FileEntrySize)) +
+            readU32(Files + I * FileEntrySize + 4) > Strings.size())
+      return false;
+  for (uint32_t I = 0; I != NumCallees; ++I) {
+    const char *Entry = Callees + I * CalleeEntrySize;
+    if (uint64_t(readU32(Entry)) + readU32(Entry + 4) > Strings.size() ||
+        uint64_t(readU32(Entry + 8)) + readU32(Entry + 12) > Strings.size() ||
+        uint64_t(readU32(Entry + 16)) + readU32(Entry + 20) > NumPostings)
+      return false;
+  }
+  Error.clear();
+  return true;
+}
+
+StringRef BinaryCallFile::getString(const char *Entry) const {
+  return Strings.substr(readU32(Entry), readU32(Entry + 4));
+}
+
+StringRef BinaryCallFile::getCalleeName(uint32_t Callee) const {
+  return getString(Callees + Callee * CalleeEntrySize);
+}
+
+StringRef BinaryCallFile::getCalleeDescription(uint32_t Callee) const {
+  return getString(Callees + Callee * CalleeEntrySize + 8);
+}
+
+uint32_t BinaryCallFile::getNumCallSites(uint32_t Callee) const {
+  return readU32(Callees + Callee * CalleeEntrySize + 20);
+}
+
+std::vector<uint32_t> BinaryCallFile::findCallees(StringRef Name) const {
+  // Like the hasName matcher: "::N::g" only matches N::g itself, "g" and
+  // "N::g" also match the names ending with "::" followed by them.
+  bool FullyQualified = Name.startswith("::");
+  if (FullyQualified)
+    Name = Name.drop_front(2);
+  std::vector<uint32_t> Result;
+  for (uint32_t I = 0; I != NumCallees; ++I) {
+    StringRef Callee = getCalleeName(I);
+    if (Callee == Name ||
+        (!FullyQualified && Callee.size() > Name.size() + 2 &&
+         Callee.endswith(Name) &&
+         Callee.drop_back(Name.size()).endswith("::")))
+      Result.push_back(I);
+  }
+  return Result;
+}
+
+BinaryCallFile::Site BinaryCallFile::getSite(uint32_t Record) const {
+  const char *R = Records + uint64_t(Record) * RecordSize;
+  Site S;
+  uint32_t File = readU32(R);
+  if (File < NumFiles)
+    S.FileName = getString(Files + File * FileEntrySize);
+  S.Line = readU32(R + 4);
+  S.Column = readU32(R + 8);
+  S.Callee = readU32(R + 12);
+  uint32_t Kind = readU32(R + 16);
+  S.Kind = KindNames[(Kind & KindMask) < 3 ? Kind & KindMask : 0];
+  S.InMainFile = Kind & InMainFileFlag;
+  S.CalleeDefaulted = Kind & DefaultedFlag;
+  return S;
+}
+
+std::vector<BinaryCallFile::Site>
+BinaryCallFile::getCallSites(uint32_t Callee) const {
+  const char *Entry = Callees + Callee * CalleeEntrySize;
+  uint32_t First = readU32(Entry + 16), Count = readU32(Entry + 20);
+  std::vector<Site> Sites;
+  Sites.reserve(Count);
+  for (uint32_t I = First, E = First + Count; I != E; ++I) {
+    uint32_t Record = readU32(Postings + uint64_t(I) * 4);
+    if (Record < NumRecords)
+      Sites.push_back(getSite(Record));
+  }
+  return Sites;
+}
+
+} // end namespace showcall
+} // end namespace clang
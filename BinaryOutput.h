@@ -0,0 +1,99 @@
+//===-- BinaryOutput.h - Compact binary output format -----------*- C++ -*-===//
+//
+// The text formats repeat the file and the callee of every call site, which
+// makes up most of the output of a whole project scan. The binary format
+// stores each file name and each callee once, in string tables, and the call
+// sites as fixed size records referring to them. An index at the end of the
+// file gives the call sites of each callee, so that a query only reads the
+// records it prints.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SHOW_CALL_BINARYOUTPUT_H
+#define SHOW_CALL_BINARYOUTPUT_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace llvm {
+class raw_ostream;
+}
+
+namespace clang {
+namespace showcall {
+
+class OutputWriter;
+
+/// \brief Creates the writer of --format=binary. The tables and the index
+/// are written by OutputWriter::writeFooter, so a single writer must see all
+/// the records of the output.
+std::unique_ptr<OutputWriter> createBinaryWriter(llvm::raw_ostream &OS);
+
+/// \brief A file written with --format=binary, mapped in memory.
+class BinaryCallFile {
+public:
+  /// \brief A call site, as stored in the file.
+  struct Site {
+    llvm::StringRef FileName;
+    unsigned Line;
+    unsigned Column;
+    uint32_t Callee;
+    /// "Function", "Member" or "Operator".
+    const char *Kind;
+    bool InMainFile;
+    bool CalleeDefaulted;
+  };
+
+  /// \brief Maps \p FileName, checking its tables. Returns null, with the
+  /// reason in \p Error, if it is not a valid binary show-call output.
+  static std::unique_ptr<BinaryCallFile> open(llvm::StringRef FileName,
+                                              std::string &Error);
+
+  uint64_t getNumRecords() const { return NumRecords; }
+  uint32_t getNumCallees() const { return NumCallees; }
+
+  /// \brief The qualified name of callee \p Callee.
+  llvm::StringRef getCalleeName(uint32_t Callee) const;
+  /// \brief The description of callee \p Callee, see
+  /// CallRecord::getCalleeDescription.
+  llvm::StringRef getCalleeDescription(uint32_t Callee) const;
+  /// \brief The number of call sites of callee \p Callee.
+  uint32_t getNumCallSites(uint32_t Callee) const;
+
+  /// \brief Returns the callees named \p Name, which is matched the way
+  /// --callee-name matches it: unqualified, partially or fully qualified.
+  std::vector<uint32_t> findCallees(llvm::StringRef Name) const;
+
+  /// \brief Returns the call sites of callee \p Callee, in output order.
+  /// Only their records are read.
+  std::vector<Site> getCallSites(uint32_t Callee) const;
+
+private:
+  explicit BinaryCallFile(std::unique_ptr<llvm::MemoryBuffer> Buffer)
+      : Buffer(std::move(Buffer)) {}
+
+  bool readTables(std::string &Error);
+  llvm::StringRef getString(const char *Entry) const;
+  Site getSite(uint32_t Record) const;
+
+  std::unique_ptr<llvm::MemoryBuffer> Buffer;
+  uint64_t NumRecords;
+  uint32_t NumFiles;
+  uint32_t NumCallees;
+  const char *Records;
+  const char *Files;
+  const char *Callees;
+  const char *Postings;
+  uint64_t NumPostings;
+  llvm::StringRef Strings;
+};
+
+} // end namespace showcall
+} // end namespace clang
+
+#endif // SHOW_CALL_BINARYOUTPUT_H
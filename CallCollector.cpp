@@ -0,0 +1,654 @@
+//===-- CallCollector.cpp - Extract call records from the AST -------------===//
+
+#include "CallCollector.h"
+#include "Annotations.h"
+#include "CallFilter.h"
+#include "CallRecord.h"
+#include "Preamble.h"
+#include "Runner.h"
+#include "Stats.h"
+
+#include "clang/AST/ASTConsumer.h"
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/DeclCXX.h"
+#include "clang/AST/DeclFriend.h"
+#include "clang/AST/DeclTemplate.h"
+#include "clang/ASTMatchers/ASTMatchers.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/Frontend/CompilerInstance.h"
+#include "clang/Frontend/FrontendAction.h"
+#include "clang/Lex/Lexer.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+
+namespace clang {
+namespace showcall {
+namespace {
+// Implicit declarations and template instantiations.
+bool isInstantiationOrImplicit(const Decl *D) {
+  if (D->isImplicit())
+    return true;
+  if (const FunctionDecl *FD = dyn_cast<FunctionDecl>(D))
+    return FD->isTemplateInstantiation();
+  if (const CXXRecordDecl *RD = dyn_cast<CXXRecordDecl>(D))
+    return clang::isTemplateInstantiation(RD->getTemplateSpecializationKind());
+  if (const VarDecl *VD = dyn_cast<VarDecl>(D))
+    return clang::isTemplateInstantiation(VD->getTemplateSpecializationKind());
+  return false;
+}
+} // end anonymous namespace
+} // end namespace showcall
+
+namespace ast_matchers {
+/// \brief Matches the functions accepted by the callee restrictions of
+/// \p Filter, with a cheap look at their unqualified name first.
+AST_MATCHER_P(FunctionDecl, isAcceptedCallee, const showcall::CallFilter *,
+              Filter) {
+  if (const IdentifierInfo *II = Node.getIdentifier())
+    if (!Filter->mayMatchCallee(II->getName()))
+      return false;
+  return Filter->matchesCallee(Node.getQualifiedNameAsString());
+}
+
+/// \brief Matches the declarations whose code is not written as such in the
+/// source, see showcall::isInstantiationOrImplicit.
+AST_MATCHER(Decl, isInstantiationOrImplicit) {
+  return showcall::isInstantiationOrImplicit(&Node);
+}
+} // end namespace ast_matchers
+} // end namespace clang
+
+using namespace clang::ast_matchers;
+using namespace clang::tooling;
+using namespace llvm;
+
+namespace clang {
+namespace showcall {
+
+namespace {
+// The location of the call starting at Loc. The spelling location gives the
+// file and the offset, and also the line and column of the calls not coming
+// from a macro, without decomposing Loc again. The calls coming from a macro
+// also get the location of its expansion, ExpansionFID being left invalid
+// for the others. The line and column are only looked up if NeedLineColumn.
+void getCallLocation(const SourceManager &SM, SourceLocation Loc,
+                     bool NeedLineColumn, FileID &SpellingFID,
+                     FileID &ExpansionFID, CallSite &Site) {
+  std::pair<FileID, unsigned> SpellingInfo = SM.getDecomposedSpellingLoc(Loc);
+  SpellingFID = SpellingInfo.first;
+  Site.Offset = SpellingInfo.second;
+  if (const FileEntry *FE = SM.getFileEntryForID(SpellingFID))
+    Site.FileName = FE->getName();
+  ExpansionFID = FileID();
+  if (Loc.isMacroID()) {
+    std::pair<FileID, unsigned> ExpansionInfo =
+        SM.getDecomposedExpansionLoc(Loc);
+    ExpansionFID = ExpansionInfo.first;
+    Site.ExpansionOffset = ExpansionInfo.second;
+    if (const FileEntry *FE = SM.getFileEntryForID(ExpansionFID))
+      Site.ExpansionFileName = FE->getName();
+  }
+  if (!NeedLineColumn)
+    return;
+  std::pair<FileID, unsigned> LocInfo =
+      Loc.isFileID() ? SpellingInfo : SM.getDecomposedLoc(Loc);
+  Site.Line = SM.getLineNumber(LocInfo.first, LocInfo.second);
+  Site.Column = SM.getColumnNumber(LocInfo.first, LocInfo.second);
+}
+
+void getSourceInfo(const SourceManager &SM, const SourceLocation &Loc,
+                   StringRef &filename, unsigned &line) {
+  std::pair<FileID, unsigned> LocInfo = SM.getDecomposedLoc(Loc);
+  FileID FID = LocInfo.first;
+  unsigned FileOffset = LocInfo.second;
+  filename = SM.getFilename(Loc);
+  line = SM.getLineNumber(FID, FileOffset);
+}
+
+// The --annotate comment replacing the last character of a call, C.
+std::string makeAnnotation(char C, StringRef Description) {
+  std::string Annotation(1, C);
+  Annotation += " /* ";
+  Annotation += Description;
+  Annotation += " */";
+  return Annotation;
+}
+
+// What the copies of a call in the instantiations of a template share, and
+// the other calls of the template do not: its whole source range.
+std::pair<unsigned, unsigned> getGroupKey(const CallExpr *Call) {
+  return std::make_pair(Call->getLocStart().getRawEncoding(),
+                        Call->getLocEnd().getRawEncoding());
+}
+
+// The closest function around S, if any.
+const FunctionDecl *getCaller(ASTContext &Context, const Stmt *S) {
+  ast_type_traits::DynTypedNode Node =
+      ast_type_traits::DynTypedNode::create(*S);
+  while (true) {
+    auto Parents = Context.getParents(Node);
+    if (Parents.empty())
+      return nullptr;
+    Node = Parents[0];
+    if (const FunctionDecl *FD = Node.get<FunctionDecl>())
+      return FD;
+  }
+}
+} // end anonymous namespace
+
+void SCCallBack::run(const MatchFinder::MatchResult &Result) {
+  const SourceManager &SM = *Result.SourceManager;
+  const LangOptions &LangOpts = Result.Context->getLangOpts();
+
+  if (const CallExpr *call =
+          Result.Nodes.getNodeAs<CallExpr>("call")) {
+
+    const char *callKind = "Function";
+
+    if (isa<CXXMemberCallExpr>(call))
+      callKind = "Member";
+    else if (isa<CXXOperatorCallExpr>(call))
+      callKind = "Operator";
+
+    if (Options.Stats)
+      Options.Stats->addMatch(callKind);
+    dumpCallInfo(callKind, SM, call, LangOpts, *Result.Context);
+
+    return;
+  }
+
+  assert(false && "Unhandled match !");
+}
+
+void SCCallBack::dumpCallInfo(const char *CallKind, const SourceManager &SM,
+                              const CallExpr *call,
+                              const LangOptions &LangOpts,
+                              ASTContext &Context) {
+
+  CallSite Site;
+  FileID SpellingFID, ExpansionFID;
+  {
+    StatsTimer Timer(Options.Stats, SP_SourceInfo);
+    getCallLocation(SM, call->getLocStart(),
+                    Options.NeedLineColumn || Filter.hasLineRestriction(),
+                    SpellingFID, ExpansionFID, Site);
+  }
+
+  if (!Filter.matchesLine(Site.Line))
+    return;
+
+  // Calls through a pointer to function have no declaration to show, and
+  // neither have the unresolved calls in the body of a template.
+  const FunctionDecl *CalleeDecl =
+      dyn_cast_or_null<FunctionDecl>(call->getCalleeDecl());
+  if (!CalleeDecl)
+    return;
+
+  // Each instantiation of a template has its own copy of the calls of the
+  // template, at the same location.
+  if (Options.GroupInstantiations) {
+    llvm::DenseMap<std::pair<unsigned, unsigned>, size_t>::iterator Known =
+        PendingIndex.find(getGroupKey(call));
+    if (Known != PendingIndex.end()) {
+      PendingCall &First = Pending[Known->second];
+      if (CalleeDecl == First.Callee)
+        return;
+      const std::string &Description =
+          getCalleeInfo(SM, CalleeDecl).Description;
+      std::vector<std::string> &Others = First.Record.InstantiationCallees;
+      if (Description != getCalleeInfo(SM, First.Callee).Description &&
+          std::find(Others.begin(), Others.end(), Description) ==
+              Others.end())
+        Others.push_back(Description);
+      return;
+    }
+  }
+
+  Site.InMainFile = SM.isInMainFile(SM.getExpansionLoc(call->getLocStart()));
+  // The expansions of a macro share the spelling of its calls. Both names
+  // live in AbsoluteFileNames, which the second lookup may rehash.
+  if (Options.SeenHeaderCalls && !Site.InMainFile) {
+    std::string ExpansionFileName;
+    if (ExpansionFID.isValid())
+      ExpansionFileName = getAbsoluteFileName(SM, ExpansionFID);
+    if (!Options.SeenHeaderCalls->insert(getAbsoluteFileName(SM, SpellingFID),
+                                         Site.Offset, ExpansionFileName,
+                                         Site.ExpansionOffset))
+      return;
+  }
+
+  Site.Kind = CallKind;
+  if (Options.NeedCallText)
+    Site.CallText = Lexer::getSourceText(
+        CharSourceRange::getTokenRange(call->getSourceRange()), SM, LangOpts);
+  Site.Call = call;
+
+  if (Options.FindCaller) {
+    Site.Caller = getCaller(Context, call);
+    if (Site.Caller)
+      Site.CallerName = getCallerName(Site.Caller);
+  }
+
+  const CalleeInfo &Callee = getCalleeInfo(SM, CalleeDecl);
+  Site.Callee = CalleeDecl;
+  Site.CalleeName = Callee.Name;
+  Site.CalleeType = Callee.Type;
+  Site.CalleeFileName = Callee.FileName;
+  Site.CalleeLine = Callee.Line;
+  Site.CalleeDefaulted = Callee.Defaulted;
+
+  PendingCall *Group = nullptr;
+  if (Options.GroupInstantiations) {
+    PendingIndex[getGroupKey(call)] = Pending.size();
+    Pending.push_back(PendingCall());
+    Group = &Pending.back();
+    Group->Callee = CalleeDecl;
+  }
+
+  if (Options.Annotations) {
+    StatsTimer Timer(Options.Stats, SP_Output);
+    char c = *FullSourceLoc(call->getLocEnd(), SM).getCharacterData();
+    CharSourceRange InsertPt = CharSourceRange::getTokenRange(
+        call->getLocEnd(), call->getLocEnd());
+    Replacement R(SM, InsertPt, makeAnnotation(c, Callee.Description));
+    R = Replacement(showcall::getAbsoluteFileName(SM, R.getFilePath()),
+                    R.getOffset(), R.getLength(), R.getReplacementText());
+    // The comment of a group waits for the callees of all instantiations.
+    if (Group) {
+      Group->Annotation = R;
+      Group->LastChar = c;
+      Group->HasAnnotation = true;
+    } else {
+      Options.Annotations->insert(R);
+    }
+  }
+
+  if (SiteSink) {
+    StatsTimer Timer(Options.Stats, SP_Output);
+    SiteSink(Site);
+    return;
+  }
+
+  // The strings of the scratch record keep their storage from one call to
+  // the next; only the sink copies them.
+  CallRecord &Record = Scratch;
+  Site.copyTo(Record);
+  Record.InstantiationCallees.clear();
+  Record.CallAST.clear();
+  // The dump file names the callees so that the dumps of the calls and of
+  // their callee match.
+  std::string CalleeKey;
+  if (Options.ASTDumps || Options.ClaimedCallees)
+    CalleeKey = Record.getCalleeKey();
+  if (Options.ShowCallAST) {
+    std::string Dump = dumpAST(call, SM, Options.DumpLimits);
+    if (Options.ASTDumps)
+      Options.ASTDumps->addCall(Site, CalleeKey, std::move(Dump));
+    else
+      Record.CallAST.swap(Dump);
+  }
+  Record.CalleeAST.clear();
+  // Only the first call to a callee dumps it.
+  if (Options.ShowCalleeAST &&
+      SeenCallees.insert(CalleeDecl->getCanonicalDecl()).second &&
+      (!Options.ClaimedCallees || Options.ClaimedCallees->claim(CalleeKey))) {
+    std::string Dump = dumpAST(CalleeDecl, Options.DumpLimits);
+    if (Options.ASTDumps)
+      Options.ASTDumps->addCallee(CalleeKey, std::move(Dump));
+    else
+      Record.CalleeAST.swap(Dump);
+  }
+
+  if (Group) {
+    Group->Record = Record;
+    return;
+  }
+  StatsTimer Timer(Options.Stats, SP_Output);
+  Sink(Record);
+}
+
+void SCCallBack::flushPending() {
+  StatsTimer Timer(Options.Stats, SP_Output);
+  for (const PendingCall &Call : Pending) {
+    if (Call.HasAnnotation) {
+      std::string Description = Call.Record.getCalleeDescription();
+      for (const std::string &Other : Call.Record.InstantiationCallees)
+        Description += " | " + Other;
+      Options.Annotations->insert(Replacement(
+          Call.Annotation.getFilePath(), Call.Annotation.getOffset(),
+          Call.Annotation.getLength(),
+          makeAnnotation(Call.LastChar, Description)));
+    }
+    Sink(Call.Record);
+  }
+  Pending.clear();
+  PendingIndex.clear();
+}
+
+const SCCallBack::CalleeInfo &
+SCCallBack::getCalleeInfo(const SourceManager &SM,
+                          const FunctionDecl *CalleeDecl) {
+  const CalleeInfo *&Known = Callees[CalleeDecl];
+  if (Known)
+    return *Known;
+  CalleeStorage.push_back(CalleeInfo());
+  CalleeInfo &Info = CalleeStorage.back();
+  Known = &Info;
+  Info.Name = CalleeDecl->getQualifiedNameAsString();
+  Info.Type = QualType::getAsString(CalleeDecl->getType().split());
+  Info.Defaulted = CalleeDecl->isDefaulted();
+  if (!Info.Defaulted) {
+    StatsTimer Timer(Options.Stats, SP_SourceInfo);
+    StringRef DeclFileName;
+    getSourceInfo(SM, CalleeDecl->getLocStart(), DeclFileName, Info.Line);
+    Info.FileName = DeclFileName;
+  }
+  CallRecord Record;
+  Record.CalleeName = Info.Name;
+  Record.CalleeType = Info.Type;
+  Record.CalleeFileName = Info.FileName;
+  Record.CalleeLine = Info.Line;
+  Record.CalleeDefaulted = Info.Defaulted;
+  Info.Description = Record.getCalleeDescription();
+  return Info;
+}
+
+const std::string &SCCallBack::getCallerName(const FunctionDecl *Caller) {
+  const std::string *&Known = CallerNames[Caller];
+  if (!Known) {
+    CallerStorage.push_back(Caller->getQualifiedNameAsString());
+    Known = &CallerStorage.back();
+  }
+  return *Known;
+}
+
+void SCCallBack::releaseCaches() {
+  llvm::DenseMap<const FunctionDecl *, const CalleeInfo *>().swap(Callees);
+  std::deque<CalleeInfo>().swap(CalleeStorage);
+  llvm::DenseMap<const FunctionDecl *, const std::string *>().swap(
+      CallerNames);
+  std::deque<std::string>().swap(CallerStorage);
+}
+
+std::unique_ptr<SCCallBack> SCCallBack::create(const CallFilter &Filter,
+                                               CallSiteSink Sink,
+                                               const CallBackOptions &Options) {
+  std::unique_ptr<SCCallBack> Callback(
+      new SCCallBack(Filter, RecordSink(), Options));
+  Callback->SiteSink = Sink;
+  Callback->Options.ShowCallAST = false;
+  Callback->Options.ShowCalleeAST = false;
+  Callback->Options.GroupInstantiations = false;
+  return Callback;
+}
+
+void SCCallBack::onStartOfTranslationUnit() {
+  AbsoluteFileNames.clear();
+  SeenCallees.clear();
+  releaseCaches();
+  Pending.clear();
+  PendingIndex.clear();
+  if (Options.Stats)
+    MatchStart = PhaseTime::now();
+}
+
+void SCCallBack::onEndOfTranslationUnit() {
+  flushPending();
+  // The declarations die with the translation unit.
+  releaseCaches();
+  if (Options.Stats)
+    Options.Stats->add(SP_Match, MatchStart, PhaseTime::now());
+}
+
+StringRef SCCallBack::getAbsoluteFileName(const SourceManager &SM,
+                                          FileID FID) {
+  std::string &Name = AbsoluteFileNames[FID];
+  if (Name.empty())
+    Name = showcall::getAbsoluteFileName(
+        SM, SM.getFilename(SM.getLocForStartOfFile(FID)));
+  return Name;
+}
+
+namespace {
+StatementMatcher makeAnyCallMatcher(const CallFilter &Filter) {
+  // A single matcher whatever the number of callee names, see
+  // CallFilter::matchesCallee.
+  if (Filter.isMainFileOnly()) {
+    if (Filter.hasCalleeRestriction())
+      return callExpr(isExpansionInMainFile(),
+                      callee(functionDecl(isAcceptedCallee(&Filter))))
+          .bind("call");
+    return callExpr(isExpansionInMainFile()).bind("call");
+  }
+  if (Filter.hasCalleeRestriction())
+    return callExpr(callee(functionDecl(isAcceptedCallee(&Filter))))
+        .bind("call");
+  return callExpr().bind("call");
+  //return memberCallExpr(on(hasType(asString("N::C *"))),
+  //                      callee(methodDecl(hasName("f")))).bind("call");
+}
+} // end anonymous namespace
+
+StatementMatcher makeCallMatcher(const CallFilter &Filter) {
+  StatementMatcher Calls = makeAnyCallMatcher(Filter);
+  if (!Filter.skipsInstantiations())
+    return Calls;
+  // matchRestricted does not traverse the instantiations.
+  return callExpr(Calls, callee(functionDecl()));
+}
+
+void addCallMatcher(MatchFinder &Finder, SCCallBack &Callback,
+                    const CallFilter &Filter) {
+  StatementMatcher Calls = makeCallMatcher(Filter);
+  // A MatchFinder traverses them all: the ancestors are only looked at for
+  // the calls passing the other restrictions.
+  if (Filter.skipsInstantiations())
+    Calls = callExpr(Calls,
+                     unless(hasAncestor(decl(isInstantiationOrImplicit()))));
+  Finder.addMatcher(Calls, &Callback);
+}
+
+namespace {
+// Whether the source range of D may hold calls accepted by Filter. Ranges
+// starting or ending in a macro, or spanning files, are always searched for
+// lines; declarations coming from an include never hold main file calls.
+bool mayContainMatches(const SourceManager &SM, const Decl *D,
+                       const CallFilter &Filter) {
+  SourceRange Range = D->getSourceRange();
+  if (Filter.isMainFileOnly() && Range.isValid() &&
+      !SM.isInMainFile(SM.getExpansionLoc(Range.getBegin())))
+    return false;
+  if (!Filter.hasLineRestriction())
+    return true;
+  if (Range.isInvalid() || !Range.getBegin().isFileID() ||
+      !Range.getEnd().isFileID() ||
+      SM.getFileID(Range.getBegin()) != SM.getFileID(Range.getEnd()))
+    return true;
+  return Filter.overlapsLines(SM.getExpansionLineNumber(Range.getBegin()),
+                              SM.getExpansionLineNumber(Range.getEnd()));
+}
+
+void matchInDeclContext(ASTContext &Context, const DeclContext *DC,
+                        const DeclarationMatcher &Matcher,
+                        MatchFinder::MatchCallback &Callback,
+                        const CallFilter &Filter) {
+  const SourceManager &SM = Context.getSourceManager();
+  for (const Decl *D : DC->decls()) {
+    if (!mayContainMatches(SM, D, Filter))
+      continue;
+    // Namespaces can be huge: look at their members one by one.
+    if (isa<NamespaceDecl>(D) || isa<LinkageSpecDecl>(D)) {
+      matchInDeclContext(Context, cast<DeclContext>(D), Matcher, Callback,
+                         Filter);
+      continue;
+    }
+    if (Filter.skipsInstantiations()) {
+      // The traversal of a template goes through its instantiations: only
+      // look at its pattern. The same goes for the member templates, hence
+      // the classes are looked at member by member.
+      if (isInstantiationOrImplicit(D))
+        continue;
+      if (const FriendDecl *Friend = dyn_cast<FriendDecl>(D))
+        if (const NamedDecl *Befriended = Friend->getFriendDecl())
+          D = Befriended;
+      if (const TemplateDecl *Template = dyn_cast<TemplateDecl>(D)) {
+        D = Template->getTemplatedDecl();
+        if (!D)
+          continue;
+      }
+      if (const CXXRecordDecl *Record = dyn_cast<CXXRecordDecl>(D)) {
+        matchInDeclContext(Context, Record, Matcher, Callback, Filter);
+        continue;
+      }
+    }
+    for (const BoundNodes &Nodes : match(Matcher, *D, Context))
+      Callback.run(MatchFinder::MatchResult(Nodes, &Context));
+  }
+}
+
+// Runs Finder over the whole AST once parsed, or when it is null Matcher
+// with matchRestricted, and adds the time spent parsing to Stats.
+class CallConsumer : public ASTConsumer {
+public:
+  CallConsumer(MatchFinder *Finder, const StatementMatcher &Matcher,
+               MatchFinder::MatchCallback &Callback, const CallFilter &Filter,
+               TUStats *Stats)
+      : Finder(Finder), Matcher(Matcher), Callback(Callback), Filter(Filter),
+        Stats(Stats), Context(nullptr) {
+    if (Stats)
+      ParseStart = PhaseTime::now();
+  }
+
+  void Initialize(ASTContext &Ctx) override { Context = &Ctx; }
+
+  // A body starting after the last accepted line, or outside of the main
+  // file with --main-file-only, cannot hold any of the calls we are after.
+  // Sema still parses the bodies it needs, e.g. the ones of constexpr
+  // functions. Only asked when restricted, see CallAction.
+  bool shouldSkipFunctionBody(Decl *D) override {
+    const SourceManager &SM = Context->getSourceManager();
+    SourceLocation Loc = D->getLocStart();
+    if (Filter.isMainFileOnly() && Loc.isValid() &&
+        !SM.isInMainFile(SM.getExpansionLoc(Loc)))
+      return true;
+    if (!Loc.isFileID())
+      return false;
+    return !Filter.overlapsLines(SM.getExpansionLineNumber(Loc), ~0u);
+  }
+
+  void HandleTranslationUnit(ASTContext &Ctx) override {
+    if (Stats)
+      Stats->add(SP_Parse, ParseStart, PhaseTime::now());
+    if (Finder)
+      Finder->matchAST(Ctx);
+    else
+      matchRestricted(Ctx, Matcher, Callback, Filter);
+  }
+
+private:
+  MatchFinder *Finder;
+  StatementMatcher Matcher;
+  MatchFinder::MatchCallback &Callback;
+  const CallFilter &Filter;
+  TUStats *Stats;
+  ASTContext *Context;
+  PhaseTime ParseStart;
+};
+
+class CallAction : public ASTFrontendAction {
+public:
+  CallAction(MatchFinder *Finder, const StatementMatcher &Matcher,
+             MatchFinder::MatchCallback &Callback, const CallFilter &Filter,
+             TUStats *Stats)
+      : Finder(Finder), Matcher(Matcher), Callback(Callback), Filter(Filter),
+        Stats(Stats) { }
+
+protected:
+  std::unique_ptr<ASTConsumer> CreateASTConsumer(CompilerInstance &CI,
+                                                 StringRef InFile) override {
+    // Gives CallConsumer::shouldSkipFunctionBody a say.
+    if (!Finder)
+      CI.getFrontendOpts().SkipFunctionBodies = true;
+    return std::unique_ptr<ASTConsumer>(
+        new CallConsumer(Finder, Matcher, Callback, Filter, Stats));
+  }
+
+private:
+  MatchFinder *Finder;
+  StatementMatcher Matcher;
+  MatchFinder::MatchCallback &Callback;
+  const CallFilter &Filter;
+  TUStats *Stats;
+};
+
+class CallActionFactory : public FrontendActionFactory {
+public:
+  CallActionFactory(MatchFinder *Finder, const StatementMatcher &Matcher,
+                    MatchFinder::MatchCallback &Callback,
+                    const CallFilter &Filter, TUStats *Stats)
+      : Finder(Finder), Matcher(Matcher), Callback(Callback), Filter(Filter),
+        Stats(Stats) { }
+
+  FrontendAction *create() override {
+    return new CallAction(Finder, Matcher, Callback, Filter, Stats);
+  }
+
+private:
+  MatchFinder *Finder;
+  StatementMatcher Matcher;
+  MatchFinder::MatchCallback &Callback;
+  const CallFilter &Filter;
+  TUStats *Stats;
+};
+} // end anonymous namespace
+
+void matchRestricted(ASTContext &Context, const StatementMatcher &Matcher,
+                     MatchFinder::MatchCallback &Callback,
+                     const CallFilter &Filter) {
+  Callback.onStartOfTranslationUnit();
+  matchInDeclContext(Context, Context.getTranslationUnitDecl(),
+                     decl(forEachDescendant(Matcher)), Callback, Filter);
+  Callback.onEndOfTranslationUnit();
+}
+
+std::unique_ptr<FrontendActionFactory>
+newRestrictedActionFactory(const StatementMatcher &Matcher,
+                           MatchFinder::MatchCallback &Callback,
+                           const CallFilter &Filter, TUStats *Stats) {
+  return std::unique_ptr<FrontendActionFactory>(
+      new CallActionFactory(nullptr, Matcher, Callback, Filter, Stats));
+}
+
+bool collectCalls(const CompilationDatabase &Compilations, StringRef SourcePath,
+                  const CallFilter &Filter, SCCallBack &Callback,
+                  vfs::FileSystem *FS, PreambleCache *Preambles) {
+  MatchFinder Finder;
+  std::unique_ptr<FrontendActionFactory> Factory;
+  if (Filter.restrictsTraversal()) {
+    Factory = newRestrictedActionFactory(makeCallMatcher(Filter), Callback,
+                                         Filter, Callback.getStats());
+  } else {
+    addCallMatcher(Finder, Callback, Filter);
+    Factory.reset(new CallActionFactory(&Finder, makeCallMatcher(Filter),
+                                        Callback, Filter,
+                                        Callback.getStats()));
+  }
+
+  if (!Preambles)
+    return runOnSourcePath(Compilations, SourcePath, *Factory, FS);
+  return runOnSourcePath(Compilations, SourcePath, *Preambles->wrap(*Factory),
+                         FS);
+}
+
+bool findCallSites(const CompilationDatabase &Compilations,
+                   StringRef SourcePath, const CallFilter &Filter,
+                   CallSiteSink Sink, const CallBackOptions &Options,
+                   vfs::FileSystem *FS) {
+  std::unique_ptr<SCCallBack> Callback =
+      SCCallBack::create(Filter, Sink, Options);
+  return collectCalls(Compilations, SourcePath, Filter, *Callback, FS);
+}
+
+} // end namespace showcall
+} // end namespace clang
@@ -0,0 +1,250 @@
+//===-- CallCollector.h - Extract call records from the AST -----*- C++ -*-===//
+//
+// The AST matcher callback at the heart of show-call: it turns every matched
+// call expression into a CallSite, and for the show-call tool, into a
+// CallRecord. This is also the entry point of the programs embedding
+// show-call, see findCallSites.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SHOW_CALL_CALLCOLLECTOR_H
+#define SHOW_CALL_CALLCOLLECTOR_H
+
+#include "ASTDump.h"
+#include "CallRecord.h"
+#include "CallSite.h"
+#include "Stats.h"
+
+#include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "clang/ASTMatchers/ASTMatchers.h"
+#include "clang/Basic/SourceLocation.h"
+#include "clang/Tooling/Refactoring.h"
+#include "clang/Tooling/Tooling.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace clang {
+class ASTContext;
+class CallExpr;
+class Decl;
+class FunctionDecl;
+class LangOptions;
+class SourceManager;
+
+namespace vfs {
+class FileSystem;
+}
+
+namespace showcall {
+
+class AnnotationSet;
+class CallFilter;
+class CallSiteSet;
+class PreambleCache;
+
+/// \brief What SCCallBack extracts besides the call records themselves.
+struct CallBackOptions {
+  /// Fill CallRecord::CallAST.
+  bool ShowCallAST;
+  /// Fill CallRecord::CalleeAST.
+  bool ShowCalleeAST;
+  /// When not null, the dumps asked for by ShowCallAST and ShowCalleeAST go
+  /// there instead of the records.
+  ASTDumpFile *ASTDumps;
+  /// When not null, a callee is only dumped by the first call to it this
+  /// set sees; otherwise by the first call to it in each translation unit.
+  DumpedCallees *ClaimedCallees;
+  /// Applied to every dump.
+  ASTDumpLimits DumpLimits;
+  /// Receives the --annotate comments, when not null.
+  AnnotationSet *Annotations;
+  /// When not null, the calls outside of the main file are only reported if
+  /// they are not in this set yet (--dedup-headers).
+  CallSiteSet *SeenHeaderCalls;
+  /// Receives the --stats timings and counters, when not null.
+  TUStats *Stats;
+  /// Fill CallRecord::CallerName. This needs the parent map of the AST.
+  bool FindCaller;
+  /// Report the calls of all the instantiations of a template once, with
+  /// the other callees in CallRecord::InstantiationCallees
+  /// (--instantiations=group). Records are then only passed on at the end
+  /// of the translation unit.
+  bool GroupInstantiations;
+  /// Fill CallRecord::CallText, which needs to relex the call.
+  bool NeedCallText;
+  /// Fill CallRecord::Line and CallRecord::Column, which are always known
+  /// when the filter has a line restriction. The first line of a file asked
+  /// for builds the line table of the whole file.
+  bool NeedLineColumn;
+
+  CallBackOptions()
+      : ShowCallAST(false), ShowCalleeAST(false), ASTDumps(nullptr),
+        ClaimedCallees(nullptr), Annotations(nullptr),
+        SeenHeaderCalls(nullptr), Stats(nullptr), FindCaller(false),
+        GroupInstantiations(false), NeedCallText(true),
+        NeedLineColumn(true) {}
+};
+
+class SCCallBack : public ast_matchers::MatchFinder::MatchCallback {
+public:
+  typedef std::function<void(const CallRecord &)> RecordSink;
+
+  /// \brief Passes the calls matching the line restriction of \p Filter to
+  /// \p Sink. Callee names and the main file restriction are expected to be
+  /// enforced by the matcher, see addCallMatcher.
+  SCCallBack(const CallFilter &Filter, RecordSink Sink,
+             const CallBackOptions &Options = CallBackOptions())
+      : Filter(Filter), Sink(Sink), Options(Options) { }
+
+  /// \brief Same, passing \p Sink views of the call sites instead of
+  /// records, see CallSite. The AST dumps and
+  /// CallBackOptions::GroupInstantiations, which need records, are not
+  /// available this way; CallSite gives the AST nodes instead.
+  static std::unique_ptr<SCCallBack>
+  create(const CallFilter &Filter, CallSiteSink Sink,
+         const CallBackOptions &Options = CallBackOptions());
+
+  void run(const ast_matchers::MatchFinder::MatchResult &Result) override;
+  void onStartOfTranslationUnit() override;
+  void onEndOfTranslationUnit() override;
+
+  /// \brief Where the timings of the translation unit go, if anywhere.
+  TUStats *getStats() const { return Options.Stats; }
+
+private:
+  const CallFilter &Filter;
+  RecordSink Sink;
+  /// Set by create, used instead of Sink.
+  CallSiteSink SiteSink;
+  CallBackOptions Options;
+  /// Only used for --dedup-headers, where most calls are in a few headers.
+  llvm::DenseMap<FileID, std::string> AbsoluteFileNames;
+  PhaseTime MatchStart;
+
+  /// A call held back by CallBackOptions::GroupInstantiations.
+  struct PendingCall {
+    CallRecord Record;
+    const FunctionDecl *Callee;
+    bool HasAnnotation;
+    tooling::Replacement Annotation;
+    char LastChar;
+
+    PendingCall() : Callee(nullptr), HasAnnotation(false), LastChar(0) {}
+  };
+  /// The calls of the translation unit in match order, and the index in it
+  /// of each call, by the raw encodings of the start and the end of its
+  /// source range: calls nested in another one, as in a.b().c() or
+  /// x + y + z, start at the same location.
+  std::vector<PendingCall> Pending;
+  llvm::DenseMap<std::pair<unsigned, unsigned>, size_t> PendingIndex;
+
+  /// What the records tell of a callee. Most calls of a translation unit go
+  /// to a few callees, so this is only computed once per declaration.
+  struct CalleeInfo {
+    std::string Name;
+    std::string Type;
+    std::string FileName;
+    unsigned Line;
+    bool Defaulted;
+    /// See CallRecord::getCalleeDescription.
+    std::string Description;
+
+    CalleeInfo() : Line(0), Defaulted(false) {}
+  };
+  /// Both per translation unit, keyed by declaration, and released at its
+  /// end. The deques keep the strings the CallSites point to in place.
+  std::deque<CalleeInfo> CalleeStorage;
+  llvm::DenseMap<const FunctionDecl *, const CalleeInfo *> Callees;
+  std::deque<std::string> CallerStorage;
+  llvm::DenseMap<const FunctionDecl *, const std::string *> CallerNames;
+  /// The record being built, reused from call to call so that its strings
+  /// keep their storage.
+  CallRecord Scratch;
+  /// With CallBackOptions::ShowCalleeAST: the callees of the translation
+  /// unit already dumped, or claimed by another one, by canonical
+  /// declaration.
+  llvm::DenseSet<const Decl *> SeenCallees;
+
+  llvm::StringRef getAbsoluteFileName(const SourceManager &SM, FileID FID);
+  const CalleeInfo &getCalleeInfo(const SourceManager &SM,
+                                  const FunctionDecl *CalleeDecl);
+  const std::string &getCallerName(const FunctionDecl *Caller);
+  void releaseCaches();
+  void flushPending();
+
+  void dumpCallInfo(const char *CallKind, const SourceManager &SM,
+                    const CallExpr *call, const LangOptions &LangOpts,
+                    ASTContext &Context);
+};
+
+/// \brief Returns the matcher for the calls to the callees accepted by
+/// \p Filter, restricted to the main file if \p Filter asks so. The call is
+/// bound to "call". The matcher refers to \p Filter, which must outlive it.
+ast_matchers::StatementMatcher makeCallMatcher(const CallFilter &Filter);
+
+/// \brief Registers \p Callback for the calls selected by
+/// makeCallMatcher(\p Filter). A MatchFinder traverses the instantiations:
+/// with --instantiations=skip, each call then also has its ancestors looked
+/// at, which matchRestricted avoids.
+void addCallMatcher(ast_matchers::MatchFinder &Finder, SCCallBack &Callback,
+                    const CallFilter &Filter);
+
+/// \brief Runs \p Matcher under the declarations of \p Context which may
+/// contain calls accepted by \p Filter, skipping all the others.
+///
+/// This gives the same matches as a MatchFinder would for the accepted
+/// calls, without traversing most of the translation unit when
+/// --call-at-line or --main-file-only is given, nor the template
+/// instantiations and implicit declarations with --instantiations=skip.
+void matchRestricted(ASTContext &Context,
+                     const ast_matchers::StatementMatcher &Matcher,
+                     ast_matchers::MatchFinder::MatchCallback &Callback,
+                     const CallFilter &Filter);
+
+/// \brief Creates actions which run \p Matcher with matchRestricted, and
+/// also let the parser skip the function bodies which cannot hold calls
+/// accepted by \p Filter. The time spent parsing goes to \p Stats, if not
+/// null.
+std::unique_ptr<tooling::FrontendActionFactory>
+newRestrictedActionFactory(
+    const ast_matchers::StatementMatcher &Matcher,
+    ast_matchers::MatchFinder::MatchCallback &Callback,
+    const CallFilter &Filter, TUStats *Stats = nullptr);
+
+/// \brief Runs \p Callback over the calls of \p SourcePath accepted by
+/// \p Filter, for each of its compile commands in \p Compilations.
+///
+/// Only the parts of the file which may hold accepted calls are looked at,
+/// see newRestrictedActionFactory. Files are read through \p FS if not null,
+/// and the preamble of the file comes from \p Preambles if not null.
+///
+/// \returns false if no compile command was found or if any of the parses
+/// failed.
+bool collectCalls(const tooling::CompilationDatabase &Compilations,
+                  llvm::StringRef SourcePath, const CallFilter &Filter,
+                  SCCallBack &Callback, vfs::FileSystem *FS = nullptr,
+                  PreambleCache *Preambles = nullptr);
+
+/// \brief Passes each call of \p SourcePath accepted by \p Filter to
+/// \p Sink, as show-call would print it.
+///
+/// This is what embedders call instead of running the show-call tool. Each
+/// CallSite only points into the translation unit: \p Sink copies what it
+/// keeps beyond it.
+bool findCallSites(const tooling::CompilationDatabase &Compilations,
+                   llvm::StringRef SourcePath, const CallFilter &Filter,
+                   CallSiteSink Sink,
+                   const CallBackOptions &Options = CallBackOptions(),
+                   vfs::FileSystem *FS = nullptr);
+
+} // end namespace showcall
+} // end namespace clang
+
+#endif // SHOW_CALL_CALLCOLLECTOR_H
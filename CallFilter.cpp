@@ -0,0 +1,97 @@
+//===-- CallFilter.cpp - Select the call sites to report ------------------===//
+
+#include "CallFilter.h"
+#include "CallRecord.h"
+
+#include "llvm/ADT/Hashing.h"
+
+#include <algorithm>
+
+using namespace llvm;
+
+namespace clang {
+namespace showcall {
+
+void CallFilter::addCalleeName(StringRef Name) {
+  if (Name.startswith("::"))
+    QualifiedNames.insert(Name.substr(2));
+  else
+    CalleeNames.insert(Name);
+  size_t Pos = Name.rfind("::");
+  UnqualifiedNames.insert(Pos == StringRef::npos ? Name : Name.substr(Pos + 2));
+}
+
+bool CallFilter::setCalleeRegex(StringRef Pattern, std::string &Error) {
+  std::shared_ptr<Regex> R(new Regex(Pattern));
+  if (!R->isValid(Error))
+    return false;
+  CalleeRegex = std::move(R);
+  return true;
+}
+
+void CallFilter::addLine(unsigned Line) {
+  std::vector<unsigned>::iterator I =
+      std::lower_bound(Lines.begin(), Lines.end(), Line);
+  if (I == Lines.end() || *I != Line)
+    Lines.insert(I, Line);
+}
+
+bool CallFilter::matchesLine(unsigned L) const {
+  return Lines.empty() || std::binary_search(Lines.begin(), Lines.end(), L);
+}
+
+bool CallFilter::overlapsLines(unsigned First, unsigned Last) const {
+  if (Lines.empty())
+    return true;
+  std::vector<unsigned>::const_iterator I =
+      std::lower_bound(Lines.begin(), Lines.end(), First);
+  return I != Lines.end() && *I <= Last;
+}
+
+bool CallFilter::matchesCallee(StringRef QualifiedName) const {
+  if (!hasCalleeRestriction())
+    return true;
+  if (CalleeRegex && CalleeRegex->match("::" + QualifiedName.str()))
+    return true;
+
+  // hasName() semantics: a name matches if it is a suffix of the fully
+  // qualified name starting right after a "::", or the fully qualified name
+  // itself. Look each of those suffixes up instead of trying every name.
+  if (QualifiedNames.count(QualifiedName))
+    return true;
+  StringRef Suffix = QualifiedName;
+  while (true) {
+    if (CalleeNames.count(Suffix))
+      return true;
+    size_t Pos = Suffix.find("::");
+    if (Pos == StringRef::npos)
+      return false;
+    Suffix = Suffix.substr(Pos + 2);
+  }
+}
+
+bool CallFilter::matches(const CallRecord &Record) const {
+  return (!MainFileOnly || Record.InMainFile) && matchesLine(Record.Line) &&
+         matchesCallee(Record.CalleeName);
+}
+
+bool CallSiteSet::insert(StringRef FileName, unsigned Offset,
+                         StringRef ExpansionFileName,
+                         unsigned ExpansionOffset) {
+  std::string Key = FileName.str();
+  Key += '\0';
+  Key += std::to_string(Offset);
+  if (!ExpansionFileName.empty()) {
+    Key += '\0';
+    Key.append(ExpansionFileName.data(), ExpansionFileName.size());
+    Key += '\0';
+    Key += std::to_string(ExpansionOffset);
+  }
+
+  Shard &S = Shards[hash_value(StringRef(Key)) % NumShards];
+  std::lock_guard<std::mutex> Lock(S.Mutex);
+  return S.Keys.insert(std::move(Key)).second;
+}
+
+} // end namespace showcall
+} // end namespace clang
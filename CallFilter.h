@@ -0,0 +1,144 @@
+//===-- CallFilter.h - Select the call sites to report ----------*- C++ -*-===//
+
+#ifndef SHOW_CALL_CALLFILTER_H
+#define SHOW_CALL_CALLFILTER_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Support/Regex.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace clang {
+namespace showcall {
+
+struct CallRecord;
+
+/// \brief The --callee-name, --callee-regex, --call-at-line,
+/// --main-file-only and --instantiations=skip restrictions.
+///
+/// They are mostly enforced by the AST matchers and by skipping parts of the
+/// AST, but also apply to records which were not obtained that way, e.g. the
+/// ones read back from a CallIndex.
+class CallFilter {
+public:
+  CallFilter() : MainFileOnly(false), SkipInstantiations(false) {}
+  explicit CallFilter(unsigned Line, bool MainFileOnly = false)
+      : MainFileOnly(MainFileOnly), SkipInstantiations(false) {
+    if (Line)
+      addLine(Line);
+  }
+
+  /// \brief Accepts the calls at \p Line, besides the lines already added.
+  void addLine(unsigned Line);
+
+  void setMainFileOnly(bool Value) { MainFileOnly = Value; }
+
+  /// \brief Only report the calls as written in the source: not the ones in
+  /// template instantiations or implicit code, nor the calls whose callee
+  /// depends on a template parameter. The instantiations are then left out
+  /// of the traversal, see restrictsTraversal.
+  void setSkipInstantiations(bool Value) { SkipInstantiations = Value; }
+  bool skipsInstantiations() const { return SkipInstantiations; }
+
+  /// \brief Accepts the calls to \p Name, with the same semantics as the
+  /// hasName() matcher: it may be unqualified, partially or fully qualified.
+  void addCalleeName(llvm::StringRef Name);
+
+  /// \brief Accepts the calls to the callees whose "::"-prefixed qualified
+  /// name contains a match of \p Pattern, like the matchesName() matcher.
+  ///
+  /// \returns false, with the reason in \p Error, for an invalid pattern.
+  bool setCalleeRegex(llvm::StringRef Pattern, std::string &Error);
+
+  /// \brief Whether only the calls to some callees are of interest.
+  bool hasCalleeRestriction() const {
+    return !CalleeNames.empty() || !QualifiedNames.empty() || CalleeRegex;
+  }
+
+  /// \brief Cheap test on the unqualified name of a callee: false means
+  /// matchesCallee would be false too.
+  bool mayMatchCallee(llvm::StringRef Name) const {
+    return !hasCalleeRestriction() || CalleeRegex ||
+           UnqualifiedNames.count(Name);
+  }
+
+  /// \brief Whether one of the callee names or the regex accepts
+  /// \p QualifiedName. This takes one hash lookup per name component,
+  /// whatever the number of callee names.
+  bool matchesCallee(llvm::StringRef QualifiedName) const;
+
+  bool matchesLine(unsigned L) const;
+
+  /// \brief Only report the calls expanded in the main file of their
+  /// translation unit.
+  bool isMainFileOnly() const { return MainFileOnly; }
+
+  /// \brief Whether only some lines are of interest, see overlapsLines.
+  bool hasLineRestriction() const { return !Lines.empty(); }
+
+  /// \brief Whether any line in [\p First, \p Last] is accepted. This is a
+  /// binary search, so that declarations can be checked against hundreds of
+  /// lines cheaply.
+  bool overlapsLines(unsigned First, unsigned Last) const;
+
+  /// \brief Whether whole parts of the AST can be left out, see
+  /// matchRestricted: whole declarations, or the template instantiations.
+  bool restrictsTraversal() const {
+    return hasLineRestriction() || MainFileOnly || SkipInstantiations;
+  }
+
+  bool matches(const CallRecord &Record) const;
+
+private:
+  /// The names as given, but those starting with "::", which are in
+  /// QualifiedNames without it, and the last component of all the names.
+  /// They are looked up by StringRef, without building a string per lookup.
+  llvm::StringSet<> CalleeNames;
+  llvm::StringSet<> QualifiedNames;
+  llvm::StringSet<> UnqualifiedNames;
+  /// Shared between copies: matching does not modify it.
+  std::shared_ptr<const llvm::Regex> CalleeRegex;
+  /// Sorted, without duplicates.
+  std::vector<unsigned> Lines;
+  bool MainFileOnly;
+  bool SkipInstantiations;
+};
+
+/// \brief Thread safe set of call sites, identified by the absolute path of
+/// their file and their offset in it, and for the calls coming from a macro,
+/// by those of the macro expansion too.
+///
+/// It is used by --dedup-headers to report the calls in headers only once per
+/// run, whatever the number of translation units including them. With
+/// several threads, the translation unit reporting a call is the first one
+/// to get to it, which may change from run to run; only --merge goes through
+/// the translation units in a fixed order.
+class CallSiteSet {
+public:
+  /// \brief \p ExpansionFileName is empty, and \p ExpansionOffset 0, for
+  /// the calls not coming from a macro.
+  ///
+  /// \returns true if the call site was not in the set yet.
+  bool insert(llvm::StringRef FileName, unsigned Offset,
+              llvm::StringRef ExpansionFileName, unsigned ExpansionOffset);
+
+private:
+  // Workers mostly hit different shards, so that they rarely wait on each
+  // other.
+  enum { NumShards = 64 };
+  struct Shard {
+    std::mutex Mutex;
+    std::unordered_set<std::string> Keys;
+  };
+  Shard Shards[NumShards];
+};
+
+} // end namespace showcall
+} // end namespace clang
+
+#endif // SHOW_CALL_CALLFILTER_H
@@ -0,0 +1,192 @@
+//===-- CallIndex.cpp - On-disk cache of call records ---------------------===//
+//
+// Each entry is a text file named after the hash of the compile commands:
+//
+//   show-call-index 6
+//   dep <tab> <md5> <tab> <canonical path, see getCanonicalPath>
+//   ...
+//   calls
+//   <one serialized CallRecord per line>
+//
+//===----------------------------------------------------------------------===//
+
+#include "CallIndex.h"
+#include "CallRecord.h"
+#include "ChangedFiles.h"
+#include "Runner.h"
+
+#include "clang/Basic/FileManager.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/Tooling/CompilationDatabase.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+
+using namespace clang::tooling;
+using namespace llvm;
+
+namespace clang {
+namespace showcall {
+
+namespace {
+const char IndexMagic[] = "show-call-index 6";
+} // end anonymous namespace
+
+std::string hashFile(StringRef FileName) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> Buffer = MemoryBuffer::getFile(
+      FileName, /*FileSize=*/-1, /*RequiresNullTerminator=*/false);
+  if (!Buffer)
+    return std::string();
+  return hashContents((*Buffer)->getBuffer());
+}
+
+std::string hashContents(StringRef Data) {
+  MD5 Hash;
+  Hash.update(Data);
+  MD5::MD5Result Result;
+  Hash.final(Result);
+  SmallString<32> Str;
+  MD5::stringifyResult(Result, Str);
+  return Str.str();
+}
+
+void collectDependencies(const SourceManager &SM,
+                         std::vector<IndexDependency> &Deps) {
+  size_t First = Deps.size();
+  for (SourceManager::fileinfo_iterator I = SM.fileinfo_begin(),
+                                        E = SM.fileinfo_end();
+       I != E; ++I) {
+    IndexDependency Dep;
+    Dep.FileName = getAbsoluteFileName(SM, I->first->getName());
+    // Hash what the compiler actually saw when it is still around, unless it
+    // was not the contents of the file on disk.
+    const MemoryBuffer *Buffer = I->second->getRawBuffer();
+    if (Buffer && !I->second->BufferOverridden)
+      Dep.Hash = hashContents(Buffer->getBuffer());
+    else
+      Dep.Hash = hashFile(Dep.FileName);
+    Deps.push_back(std::move(Dep));
+  }
+  std::sort(Deps.begin() + First, Deps.end(),
+            [](const IndexDependency &A, const IndexDependency &B) {
+    return A.FileName < B.FileName;
+  });
+}
+
+CallIndex::CallIndex(StringRef Directory)
+    : Directory(Directory), HasChangedFiles(false) {}
+
+void CallIndex::setChangedFiles(ArrayRef<std::string> Files) {
+  HasChangedFiles = true;
+  // The dependencies are named the way the compiler found them, e.g. through
+  // "-I../include": both sides are compared in their canonical form.
+  for (const std::string &File : Files)
+    ChangedFiles.insert(getCanonicalPath(File));
+}
+
+std::string CallIndex::getEntryPath(ArrayRef<CompileCommand> Commands) const {
+  MD5 Hash;
+  for (const CompileCommand &Command : Commands) {
+    Hash.update(Command.Directory);
+    for (const std::string &Arg : Command.CommandLine) {
+      Hash.update(StringRef("", 1));
+      Hash.update(Arg);
+    }
+    Hash.update(StringRef("\n", 1));
+  }
+  MD5::MD5Result Result;
+  Hash.final(Result);
+  SmallString<32> Str;
+  MD5::stringifyResult(Result, Str);
+
+  SmallString<256> Path(Directory);
+  sys::path::append(Path, Str.str() + ".idx");
+  return Path.str();
+}
+
+bool CallIndex::lookup(ArrayRef<CompileCommand> Commands,
+                       std::vector<CallRecord> &Records) const {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> Buffer =
+      MemoryBuffer::getFile(getEntryPath(Commands));
+  if (!Buffer)
+    return false;
+
+  StringRef Line, Rest = (*Buffer)->getBuffer();
+  std::tie(Line, Rest) = Rest.split('\n');
+  if (Line != IndexMagic)
+    return false;
+
+  // Check every dependency before reading any record.
+  while (true) {
+    std::tie(Line, Rest) = Rest.split('\n');
+    if (Line == "calls")
+      break;
+    StringRef Tag, Hash, FileName;
+    std::tie(Tag, Line) = Line.split('\t');
+    std::tie(Hash, FileName) = Line.split('\t');
+    if (Tag != "dep" || FileName.empty())
+      return false;
+    if (HasChangedFiles ? ChangedFiles.count(FileName) != 0
+                        : hashFile(FileName) != Hash)
+      return false;
+  }
+
+  size_t First = Records.size();
+  while (!Rest.empty()) {
+    std::tie(Line, Rest) = Rest.split('\n');
+    CallRecord Record;
+    if (!deserializeRecord(Line, Record)) {
+      Records.resize(First);
+      return false;
+    }
+    Records.push_back(std::move(Record));
+  }
+  return true;
+}
+
+bool CallIndex::store(ArrayRef<CompileCommand> Commands,
+                      ArrayRef<IndexDependency> Deps,
+                      ArrayRef<CallRecord> Records) const {
+  if (sys::fs::create_directories(Directory))
+    return false;
+
+  // Write to a temporary file first, so that concurrent readers only ever
+  // see complete entries.
+  SmallString<256> Model(Directory);
+  sys::path::append(Model, "entry-%%%%%%%%.tmp");
+  int FD;
+  SmallString<256> TempPath;
+  if (sys::fs::createUniqueFile(Model, FD, TempPath))
+    return false;
+
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << IndexMagic << '\n';
+    for (const IndexDependency &Dep : Deps)
+      OS << "dep\t" << Dep.Hash << '\t' << getCanonicalPath(Dep.FileName)
+         << '\n';
+    OS << "calls\n";
+    for (const CallRecord &Record : Records)
+      serializeRecord(Record, OS);
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      sys::fs::remove(TempPath.str());
+      return false;
+    }
+  }
+
+  if (sys::fs::rename(TempPath.str(), getEntryPath(Commands))) {
+    sys::fs::remove(TempPath.str());
+    return false;
+  }
+  return true;
+}
+
+} // end namespace showcall
+} // end namespace clang
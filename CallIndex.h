@@ -0,0 +1,92 @@
+//===-- CallIndex.h - On-disk cache of call records -------------*- C++ -*-===//
+//
+// The index keeps, for each source file, every call record found in it, along
+// with the list of files its translation unit read and their content hashes.
+// An entry stays valid as long as the compile commands and the contents of
+// all those files are unchanged, in which case the file need not be parsed
+// again to answer a query.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SHOW_CALL_CALLINDEX_H
+#define SHOW_CALL_CALLINDEX_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/StringSet.h"
+
+#include <string>
+#include <vector>
+
+namespace clang {
+class SourceManager;
+
+namespace tooling {
+struct CompileCommand;
+}
+
+namespace showcall {
+
+struct CallRecord;
+
+/// \brief A file read while parsing a translation unit.
+struct IndexDependency {
+  /// Absolute path of the file.
+  std::string FileName;
+  /// Hex encoded MD5 of its contents.
+  std::string Hash;
+};
+
+/// \brief Appends to \p Deps every file loaded in \p SM.
+void collectDependencies(const SourceManager &SM,
+                         std::vector<IndexDependency> &Deps);
+
+/// \brief Hex encoded MD5 of \p Data.
+std::string hashContents(llvm::StringRef Data);
+
+/// \brief Hex encoded MD5 of the contents of \p FileName, or an empty
+/// string if it cannot be read.
+std::string hashFile(llvm::StringRef FileName);
+
+class CallIndex {
+public:
+  explicit CallIndex(llvm::StringRef Directory);
+
+  /// \brief Incremental mode: only the absolute paths in \p Files are
+  /// considered changed since the entries were stored, instead of checking
+  /// the hash of every dependency. Entries are then validated without reading
+  /// any source file, and only the translation units depending on one of
+  /// \p Files are parsed again. Paths are compared in their canonical form
+  /// (see getCanonicalPath), whichever way the compiler reached the files.
+  void setChangedFiles(llvm::ArrayRef<std::string> Files);
+
+  /// \brief Reads the records stored for \p Commands.
+  ///
+  /// \returns false if there is no entry, or if it is out of date.
+  bool lookup(llvm::ArrayRef<tooling::CompileCommand> Commands,
+              std::vector<CallRecord> &Records) const;
+
+  /// \brief Stores the records of the translation units built by
+  /// \p Commands, replacing any previous entry.
+  ///
+  /// The dependencies are stored in their canonical form, so that lookups in
+  /// the incremental mode compare them as they are read.
+  ///
+  /// \returns false if the entry could not be written.
+  bool store(llvm::ArrayRef<tooling::CompileCommand> Commands,
+             llvm::ArrayRef<IndexDependency> Deps,
+             llvm::ArrayRef<CallRecord> Records) const;
+
+private:
+  std::string getEntryPath(
+      llvm::ArrayRef<tooling::CompileCommand> Commands) const;
+
+  std::string Directory;
+  bool HasChangedFiles;
+  llvm::StringSet<> ChangedFiles;
+};
+
+} // end namespace showcall
+} // end namespace clang
+
+#endif // SHOW_CALL_CALLINDEX_H
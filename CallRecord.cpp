@@ -0,0 +1,137 @@
+//===-- CallRecord.cpp - Information about one call site ------------------===//
+//
+// Records are serialized as tab separated fields, with backslash escapes for
+// backslashes, tabs and newlines, so that one record is always one line.
+//
+//===----------------------------------------------------------------------===//
+
+#include "CallRecord.h"
+#include "CallSite.h"
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+namespace clang {
+namespace showcall {
+
+namespace {
+// CallRecord::Kind points to static strings.
+const char *getKind(StringRef Kind) {
+  if (Kind == "Member")
+    return "Member";
+  if (Kind == "Operator")
+    return "Operator";
+  return "Function";
+}
+} // end anonymous namespace
+
+void CallSite::copyTo(CallRecord &Record) const {
+  Record.Kind = Kind;
+  Record.CallText.assign(CallText.data(), CallText.size());
+  Record.FileName.assign(FileName.data(), FileName.size());
+  Record.Line = Line;
+  Record.Column = Column;
+  Record.Offset = Offset;
+  Record.ExpansionFileName.assign(ExpansionFileName.data(),
+                                  ExpansionFileName.size());
+  Record.ExpansionOffset = ExpansionOffset;
+  Record.InMainFile = InMainFile;
+  Record.CallerName.assign(CallerName.data(), CallerName.size());
+  Record.CalleeName.assign(CalleeName.data(), CalleeName.size());
+  Record.CalleeType.assign(CalleeType.data(), CalleeType.size());
+  Record.CalleeFileName.assign(CalleeFileName.data(), CalleeFileName.size());
+  Record.CalleeLine = CalleeLine;
+  Record.CalleeDefaulted = CalleeDefaulted;
+}
+
+void writeField(raw_ostream &OS, StringRef Field) {
+  for (char C : Field) {
+    switch (C) {
+    case '\\': OS << "\\\\"; break;
+    case '\t': OS << "\\t"; break;
+    case '\n': OS << "\\n"; break;
+    default:   OS << C;
+    }
+  }
+}
+
+std::string readField(StringRef Field) {
+  std::string Result;
+  Result.reserve(Field.size());
+  for (size_t I = 0, E = Field.size(); I != E; ++I) {
+    if (Field[I] != '\\' || I + 1 == E) {
+      Result += Field[I];
+      continue;
+    }
+    switch (Field[++I]) {
+    case 't': Result += '\t'; break;
+    case 'n': Result += '\n'; break;
+    default:  Result += Field[I];
+    }
+  }
+  return Result;
+}
+
+void serializeRecord(const CallRecord &R, raw_ostream &OS) {
+  OS << R.Kind << '\t';
+  writeField(OS, R.CallText);
+  OS << '\t';
+  writeField(OS, R.FileName);
+  OS << '\t' << R.Line << '\t' << R.Column << '\t' << R.Offset << '\t'
+     << (R.InMainFile ? '1' : '0') << '\t';
+  writeField(OS, R.CalleeName);
+  OS << '\t';
+  writeField(OS, R.CalleeType);
+  OS << '\t';
+  writeField(OS, R.CalleeFileName);
+  OS << '\t' << R.CalleeLine << '\t' << (R.CalleeDefaulted ? '1' : '0')
+     << '\t';
+  writeField(OS, R.CallerName);
+  OS << '\t';
+  std::string Callees;
+  for (const std::string &Callee : R.InstantiationCallees) {
+    if (!Callees.empty())
+      Callees += '\n';
+    Callees += Callee;
+  }
+  writeField(OS, Callees);
+  OS << '\t';
+  writeField(OS, R.ExpansionFileName);
+  OS << '\t' << R.ExpansionOffset << '\n';
+}
+
+bool deserializeRecord(StringRef Line, CallRecord &R) {
+  SmallVector<StringRef, 16> Fields;
+  Line.split(Fields, "\t");
+  if (Fields.size() != 16)
+    return false;
+
+  R.Kind = getKind(Fields[0]);
+  R.CallText = readField(Fields[1]);
+  R.FileName = readField(Fields[2]);
+  R.InMainFile = Fields[6] == "1";
+  R.CalleeName = readField(Fields[7]);
+  R.CalleeType = readField(Fields[8]);
+  R.CalleeFileName = readField(Fields[9]);
+  R.CalleeDefaulted = Fields[11] == "1";
+  R.CallerName = readField(Fields[12]);
+  R.InstantiationCallees.clear();
+  std::string Callees = readField(Fields[13]);
+  if (!Callees.empty()) {
+    SmallVector<StringRef, 4> Lines;
+    StringRef(Callees).split(Lines, "\n");
+    for (StringRef Callee : Lines)
+      R.InstantiationCallees.push_back(Callee);
+  }
+  R.ExpansionFileName = readField(Fields[14]);
+  return !Fields[3].getAsInteger(10, R.Line) &&
+         !Fields[4].getAsInteger(10, R.Column) &&
+         !Fields[5].getAsInteger(10, R.Offset) &&
+         !Fields[10].getAsInteger(10, R.CalleeLine) &&
+         !Fields[15].getAsInteger(10, R.ExpansionOffset);
+}
+
+} // end namespace showcall
+} // end namespace clang
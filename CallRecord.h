@@ -0,0 +1,107 @@
+//===-- CallRecord.h - Information about one call site ----------*- C++ -*-===//
+//
+// The data show-call extracts for each matched call, independently of the
+// format it is eventually printed in.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SHOW_CALL_CALLRECORD_H
+#define SHOW_CALL_CALLRECORD_H
+
+#include "llvm/ADT/StringRef.h"
+
+#include <string>
+#include <vector>
+
+namespace llvm {
+class raw_ostream;
+}
+
+namespace clang {
+namespace showcall {
+
+/// \brief A call site, and how the compiler resolved it.
+struct CallRecord {
+  /// "Function", "Member" or "Operator".
+  const char *Kind;
+  /// The call expression, as written in the source.
+  std::string CallText;
+  std::string FileName;
+  unsigned Line;
+  unsigned Column;
+  /// Offset of the call in FileName.
+  unsigned Offset;
+  /// For a call coming from a macro, where the macro is expanded: the name
+  /// of that file and the offset in it. Empty and 0 for the calls written
+  /// as such.
+  std::string ExpansionFileName;
+  unsigned ExpansionOffset;
+  /// The call is expanded in the main file of its translation unit, rather
+  /// than in one of its includes.
+  bool InMainFile;
+  /// Qualified name of the function containing the call, if it was asked
+  /// for (see CallBackOptions::FindCaller) and there is one.
+  std::string CallerName;
+
+  /// Qualified name, type and location of the callee declaration.
+  std::string CalleeName;
+  std::string CalleeType;
+  std::string CalleeFileName;
+  unsigned CalleeLine;
+  /// The callee is a defaulted special member function; it has no
+  /// meaningful location.
+  bool CalleeDefaulted;
+  /// With --instantiations=group, the descriptions of the other callees the
+  /// call resolves to in the instantiations of its template, see
+  /// getCalleeDescription.
+  std::vector<std::string> InstantiationCallees;
+
+  /// AST dumps, only filled with --show-call-ast / --show-callee-ast.
+  std::string CallAST;
+  std::string CalleeAST;
+
+  CallRecord()
+      : Kind("Function"), Line(0), Column(0), Offset(0), ExpansionOffset(0),
+        InMainFile(true), CalleeLine(0), CalleeDefaulted(false) {}
+
+  /// \brief Returns the callee as shown in the text output and the
+  /// --annotate comments, e.g. "N::g int (double) @ test.cpp:7".
+  std::string getCalleeDescription() const {
+    if (CalleeDefaulted)
+      return "(defaulted) " + CalleeType;
+    return CalleeName + ' ' + CalleeType + " @ " + CalleeFileName + ':' +
+           std::to_string(CalleeLine);
+  }
+
+  /// \brief Returns a string telling the callees apart: the description,
+  /// preceded by the name for the defaulted functions, which their
+  /// description alone does not name (e.g. the implicit destructors).
+  std::string getCalleeKey() const {
+    if (CalleeDefaulted)
+      return CalleeName + ' ' + getCalleeDescription();
+    return getCalleeDescription();
+  }
+};
+
+/// \brief Writes \p Field with the escapes of serializeRecord, so that it
+/// holds no tab nor newline.
+void writeField(llvm::raw_ostream &OS, llvm::StringRef Field);
+
+/// \brief Reads back a field written by writeField.
+std::string readField(llvm::StringRef Field);
+
+/// \brief Writes \p Record as a single line, in show-call's own format used
+/// for the files it keeps around (e.g. the CallIndex).
+///
+/// The AST dumps are not serialized.
+void serializeRecord(const CallRecord &Record, llvm::raw_ostream &OS);
+
+/// \brief Reads back a line written by serializeRecord.
+///
+/// \returns false if \p Line is not a valid record.
+bool deserializeRecord(llvm::StringRef Line, CallRecord &Record);
+
+} // end namespace showcall
+} // end namespace clang
+
+#endif // SHOW_CALL_CALLRECORD_H
@@ -0,0 +1,75 @@
+//===-- CallSite.h - A call site, as views into its TU ----------*- C++ -*-===//
+//
+// What show-call finds out about a call site, for the programs embedding it
+// rather than running the show-call tool. Unlike a CallRecord, a CallSite
+// owns nothing: its strings point into the translation unit being processed
+// and into caches living as long as it, so that the callback only pays for
+// what it keeps.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SHOW_CALL_CALLSITE_H
+#define SHOW_CALL_CALLSITE_H
+
+#include "llvm/ADT/StringRef.h"
+
+#include <functional>
+
+namespace clang {
+class CallExpr;
+class FunctionDecl;
+
+namespace showcall {
+
+struct CallRecord;
+
+/// \brief A call site, and how the compiler resolved it. Everything it
+/// refers to stays valid until the end of its translation unit.
+///
+/// The fields have the meaning of the CallRecord fields of the same name.
+struct CallSite {
+  const char *Kind;
+  /// Empty unless CallBackOptions::NeedCallText is set.
+  llvm::StringRef CallText;
+  llvm::StringRef FileName;
+  /// 0 unless CallBackOptions::NeedLineColumn is set, or the filter has a
+  /// line restriction.
+  unsigned Line;
+  unsigned Column;
+  unsigned Offset;
+  llvm::StringRef ExpansionFileName;
+  unsigned ExpansionOffset;
+  bool InMainFile;
+  /// Empty unless CallBackOptions::FindCaller is set.
+  llvm::StringRef CallerName;
+
+  llvm::StringRef CalleeName;
+  llvm::StringRef CalleeType;
+  llvm::StringRef CalleeFileName;
+  unsigned CalleeLine;
+  bool CalleeDefaulted;
+
+  /// The AST nodes themselves, for whatever else the embedder is after.
+  const CallExpr *Call;
+  const FunctionDecl *Callee;
+  /// Null unless CallBackOptions::FindCaller is set and there is one.
+  const FunctionDecl *Caller;
+
+  CallSite()
+      : Kind("Function"), Line(0), Column(0), Offset(0), ExpansionOffset(0),
+        InMainFile(true), CalleeLine(0), CalleeDefaulted(false),
+        Call(nullptr), Callee(nullptr), Caller(nullptr) {}
+
+  /// \brief Copies the fields of this call site to \p Record, reusing the
+  /// storage of its strings. The AST dumps and InstantiationCallees of
+  /// \p Record are left alone.
+  void copyTo(CallRecord &Record) const;
+};
+
+/// \brief Receives the call sites, see SCCallBack::create.
+typedef std::function<void(const CallSite &)> CallSiteSink;
+
+} // end namespace showcall
+} // end namespace clang
+
+#endif // SHOW_CALL_CALLSITE_H
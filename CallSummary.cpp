@@ -0,0 +1,151 @@
+//===-- CallSummary.cpp - Aggregated call counts --------------------------===//
+
+#include "CallSummary.h"
+#include "CallRecord.h"
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace llvm;
+
+namespace clang {
+namespace showcall {
+
+namespace {
+typedef std::pair<StringRef, uint64_t> Entry;
+
+// Most frequent first, then by name so that the output is stable.
+bool isMoreFrequent(const Entry &A, const Entry &B) {
+  return A.second != B.second ? A.second > B.second : A.first < B.first;
+}
+
+// Sorts the TopK most frequent entries of Entries to the front, and drops
+// the others.
+void keepTop(std::vector<Entry> &Entries, unsigned TopK) {
+  if (TopK == 0 || TopK >= Entries.size()) {
+    std::sort(Entries.begin(), Entries.end(), isMoreFrequent);
+    return;
+  }
+  std::partial_sort(Entries.begin(), Entries.begin() + TopK, Entries.end(),
+                    isMoreFrequent);
+  Entries.resize(TopK);
+}
+
+// The 97.5th percentile of Student's t distribution with DF degrees of
+// freedom, for two-sided 95% intervals. Between the values of the table, the
+// one of the lower degree is used, which errs on the wide side.
+double getStudentT975(uint64_t DF) {
+  static const double Table[] = {
+      12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+      2.201,  2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+      2.080,  2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+  if (DF <= 30)
+    return Table[DF - 1];
+  if (DF <= 40)
+    return 2.042;
+  if (DF <= 60)
+    return 2.021;
+  if (DF <= 120)
+    return 2.000;
+  return 1.980;
+}
+
+template <typename MapT>
+void printTop(raw_ostream &OS, const char *What, const MapT &Counters,
+              unsigned TopK) {
+  std::vector<Entry> Entries(Counters.begin(), Counters.end());
+  keepTop(Entries, TopK);
+  for (const Entry &E : Entries)
+    OS << format("    %10llu ", (unsigned long long)E.second) << What << ' '
+       << E.first << '\n';
+}
+} // end anonymous namespace
+
+void CallSummary::add(const CallRecord &Record) {
+  CalleeCounters &Counters = Callees[Record.getCalleeKey()];
+  ++Counters.Calls;
+  Counters.SquaredCalls = Counters.Calls * Counters.Calls;
+  ++Counters.Callers[Record.CallerName.empty() ? "<global>"
+                                               : Record.CallerName];
+  ++Counters.Files[Record.FileName];
+  ++Calls;
+  SquaredCalls = Calls * Calls;
+}
+
+void CallSummary::merge(const CallSummary &Other) {
+  // This summary may itself be that of a single file, counted with add().
+  if (Units == 0 && Calls != 0)
+    Units = 1;
+  for (const auto &Callee : Other.Callees) {
+    CalleeCounters &Counters = Callees[Callee.first];
+    Counters.Calls += Callee.second.Calls;
+    Counters.SquaredCalls += Callee.second.SquaredCalls;
+    for (const auto &Caller : Callee.second.Callers)
+      Counters.Callers[Caller.first] += Caller.second;
+    for (const auto &File : Callee.second.Files)
+      Counters.Files[File.first] += File.second;
+  }
+  Calls += Other.Calls;
+  SquaredCalls += Other.SquaredCalls;
+  Units += std::max<uint64_t>(Other.Units, 1);
+}
+
+void CallSummary::printEstimate(raw_ostream &OS, uint64_t Sum,
+                                uint64_t Squares) const {
+  // Sampling n of the N files without replacement: the total is estimated
+  // as N times the mean per file, whose variance shrinks with the finite
+  // population correction 1 - n / N.
+  double N = Population, n = std::max<uint64_t>(Units, 1);
+  double Mean = Sum / n;
+  OS << format("%10.0f +- ", N * Mean);
+  if (n >= N) {
+    OS << format("%-8.0f ", 0.0);
+    return;
+  }
+  if (n < 2) {
+    OS << format("%-8s ", "?");
+    return;
+  }
+  double Variance = std::max(0.0, (Squares - Sum * Mean) / (n - 1));
+  double HalfWidth = getStudentT975(uint64_t(n) - 1) * N *
+                     std::sqrt((1 - n / N) * Variance / n);
+  OS << format("%-8.0f ", HalfWidth);
+}
+
+void CallSummary::print(raw_ostream &OS, unsigned TopK) const {
+  if (Population) {
+    OS << "sampled " << std::max<uint64_t>(Units, 1) << " of " << Population
+       << " files: " << Calls << " calls to " << Callees.size() << " callees\n"
+       << "estimated over all the files, with 95% confidence (callers and "
+          "files are those of the sample):\n";
+    printEstimate(OS, Calls, SquaredCalls);
+    OS << "calls\n";
+  } else {
+    OS << Calls << " calls to " << Callees.size() << " callees\n";
+  }
+
+  std::vector<Entry> Entries;
+  Entries.reserve(Callees.size());
+  for (const auto &Callee : Callees)
+    Entries.push_back(Entry(Callee.first, Callee.second.Calls));
+  keepTop(Entries, TopK);
+
+  for (const Entry &E : Entries) {
+    const CalleeCounters &Counters = Callees.find(E.first.str())->second;
+    if (Population)
+      printEstimate(OS, Counters.Calls, Counters.SquaredCalls);
+    else
+      OS << format("%10llu ", (unsigned long long)E.second);
+    OS << E.first << '\n';
+    printTop(OS, "caller", Counters.Callers, TopK);
+    printTop(OS, "file", Counters.Files, TopK);
+  }
+}
+
+} // end namespace showcall
+} // end namespace clang
@@ -0,0 +1,84 @@
+//===-- CallSummary.h - Aggregated call counts ------------------*- C++ -*-===//
+//
+// The --summary mode: instead of printing every call site, count the calls
+// to each callee, per caller and per file, and only print the most called
+// ones. The output size is then proportional to the number of distinct
+// callees, not to the number of call sites.
+//
+// When only a sample of the files was processed, the calls to each callee
+// over all the files are estimated from the mean calls per file of the
+// sample, with a 95% confidence interval from the spread of the counts
+// between the files.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SHOW_CALL_CALLSUMMARY_H
+#define SHOW_CALL_CALLSUMMARY_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+namespace llvm {
+class raw_ostream;
+}
+
+namespace clang {
+namespace showcall {
+
+struct CallRecord;
+
+class CallSummary {
+public:
+  CallSummary() : Calls(0), SquaredCalls(0), Units(0), Population(0) {}
+
+  /// \brief Counts the call of \p Record. All the records added to a
+  /// summary must come from the same source file, for the estimates of
+  /// sampled runs: merge() the summaries of different files.
+  void add(const CallRecord &Record);
+
+  /// \brief Adds the counts of \p Other: either the summary of a single
+  /// source file, built with add(), or a merge of such summaries.
+  void merge(const CallSummary &Other);
+
+  /// \brief Tells that the merged files are a random sample of
+  /// \p Population files, so that print() estimates the counts over all of
+  /// them.
+  void setSampled(size_t Population) { this->Population = Population; }
+
+  /// \brief Prints the \p TopK most called callees, each with its \p TopK
+  /// most frequent callers and files. A \p TopK of 0 prints everything.
+  void print(llvm::raw_ostream &OS, unsigned TopK) const;
+
+private:
+  typedef std::unordered_map<std::string, uint64_t> CounterMap;
+
+  struct CalleeCounters {
+    uint64_t Calls;
+    /// Sum over the merged files of the square of their calls.
+    uint64_t SquaredCalls;
+    CounterMap Callers;
+    CounterMap Files;
+
+    CalleeCounters() : Calls(0), SquaredCalls(0) {}
+  };
+
+  /// \brief Prints the estimate over the population of a count whose sum
+  /// and sum of squares over the merged files are \p Sum and \p Squares.
+  void printEstimate(llvm::raw_ostream &OS, uint64_t Sum,
+                     uint64_t Squares) const;
+
+  uint64_t Calls;
+  uint64_t SquaredCalls;
+  /// Number of merged files, 0 for the summary of a single one.
+  uint64_t Units;
+  /// Number of files the merged ones were sampled from, 0 if not sampled.
+  size_t Population;
+  /// Keyed by callee description, see CallRecord::getCalleeDescription.
+  std::unordered_map<std::string, CalleeCounters> Callees;
+};
+
+} // end namespace showcall
+} // end namespace clang
+
+#endif // SHOW_CALL_CALLSUMMARY_H
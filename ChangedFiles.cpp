@@ -0,0 +1,174 @@
+//===-- ChangedFiles.cpp - Files touched by a change ----------------------===//
+
+#include "ChangedFiles.h"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Program.h"
+
+#include <cstdlib>
+
+using namespace llvm;
+
+namespace clang {
+namespace showcall {
+
+namespace {
+// Removes the "." and ".." components of the absolute Path.
+std::string removeDots(StringRef Path) {
+  SmallVector<StringRef, 16> Components;
+  for (sys::path::const_iterator I = sys::path::begin(Path),
+                                 E = sys::path::end(Path);
+       I != E; ++I) {
+    if (*I == ".")
+      continue;
+    if (*I == "..") {
+      // The root stays.
+      if (Components.size() > 1)
+        Components.pop_back();
+      continue;
+    }
+    Components.push_back(*I);
+  }
+  SmallString<256> Result;
+  for (StringRef Component : Components)
+    sys::path::append(Result, Component);
+  return Result.str();
+}
+
+// Resolves the symbolic links of the existing Path, or returns false.
+bool resolveLinks(StringRef Path, std::string &Resolved) {
+#ifdef LLVM_ON_UNIX
+  SmallString<256> Name(Path);
+  if (char *Real = ::realpath(Name.c_str(), nullptr)) {
+    Resolved = Real;
+    std::free(Real);
+    return true;
+  }
+#endif
+  return false;
+}
+} // end anonymous namespace
+
+std::string getCanonicalPath(StringRef Path) {
+  SmallString<256> Absolute(Path);
+  sys::fs::make_absolute(Absolute);
+  std::string Resolved;
+  if (resolveLinks(Absolute, Resolved))
+    return Resolved;
+  // Deleted or renamed by the change: its directory may still be there.
+  std::string Clean = removeDots(Absolute);
+  if (!resolveLinks(sys::path::parent_path(Clean), Resolved))
+    return Clean;
+  SmallString<256> Result(Resolved);
+  sys::path::append(Result, sys::path::filename(Clean));
+  return Result.str();
+}
+
+namespace {
+// Appends the non empty lines of Text to Files, made canonical relative to
+// Directory, or to the current directory if Directory is empty.
+void addLines(StringRef Text, StringRef Directory,
+              std::vector<std::string> &Files) {
+  StringRef Line, Rest = Text;
+  while (!Rest.empty()) {
+    std::tie(Line, Rest) = Rest.split('\n');
+    Line = Line.trim();
+    if (Line.empty())
+      continue;
+    SmallString<256> Path;
+    if (!Directory.empty() && !sys::path::is_absolute(Line))
+      Path = Directory;
+    sys::path::append(Path, Line);
+    Files.push_back(getCanonicalPath(Path));
+  }
+}
+
+// Runs git with Args, and returns what it wrote to stdout in Output.
+bool runGit(ArrayRef<const char *> Args, std::string &Output,
+            std::string &Error) {
+  ErrorOr<std::string> Git = sys::findProgramByName("git");
+  if (!Git) {
+    Error = "cannot find git";
+    return false;
+  }
+
+  SmallString<128> OutputFile;
+  if (std::error_code EC =
+          sys::fs::createTemporaryFile("show-call-git", "txt", OutputFile)) {
+    Error = "cannot create a temporary file: " + EC.message();
+    return false;
+  }
+
+  std::vector<const char *> Argv;
+  Argv.push_back(Git->c_str());
+  Argv.insert(Argv.end(), Args.begin(), Args.end());
+  Argv.push_back(nullptr);
+  StringRef OutputRef(OutputFile);
+  const StringRef *Redirects[] = { nullptr, &OutputRef, nullptr };
+  int Result = sys::ExecuteAndWait(*Git, Argv.data(), /*env=*/nullptr,
+                                   Redirects, /*secondsToWait=*/0,
+                                   /*memoryLimit=*/0, &Error);
+
+  ErrorOr<std::unique_ptr<MemoryBuffer>> Buffer =
+      MemoryBuffer::getFile(OutputFile.str());
+  sys::fs::remove(OutputFile.str());
+  if (Result != 0) {
+    if (Error.empty())
+      Error = "git exited with status " + std::to_string(Result);
+    return false;
+  }
+  if (!Buffer) {
+    Error = "cannot read the output of git";
+    return false;
+  }
+  Output = (*Buffer)->getBuffer();
+  return true;
+}
+} // end anonymous namespace
+
+bool readChangedFiles(StringRef ListFile, std::vector<std::string> &Files,
+                      std::string &Error) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> Buffer =
+      MemoryBuffer::getFile(ListFile);
+  if (!Buffer) {
+    Error = "cannot open " + ListFile.str() + ": " +
+            Buffer.getError().message();
+    return false;
+  }
+  addLines((*Buffer)->getBuffer(), "", Files);
+  return true;
+}
+
+bool getGitChangedFiles(StringRef Revisions, std::vector<std::string> &Files,
+                        std::string &Error) {
+  // git diff prints paths relative to the top of the work tree.
+  std::string TopLevel;
+  const char *TopLevelArgs[] = { "rev-parse", "--show-toplevel" };
+  if (!runGit(TopLevelArgs, TopLevel, Error))
+    return false;
+  TopLevel = StringRef(TopLevel).trim();
+
+  std::string Diff;
+  std::string Range(Revisions);
+  const char *DiffArgs[] = { "diff", "--name-only", Range.c_str(), "--" };
+  if (!runGit(DiffArgs, Diff, Error))
+    return false;
+
+  // A new file next to an including one is found first, whether git tracks
+  // it or not yet.
+  std::string Untracked;
+  const char *UntrackedArgs[] = { "ls-files", "--others", "--exclude-standard",
+                                  "--full-name", "--", TopLevel.c_str() };
+  if (!runGit(UntrackedArgs, Untracked, Error))
+    return false;
+
+  addLines(Diff, TopLevel, Files);
+  addLines(Untracked, TopLevel, Files);
+  return true;
+}
+
+} // end namespace showcall
+} // end namespace clang
@@ -0,0 +1,43 @@
+//===-- ChangedFiles.h - Files touched by a change --------------*- C++ -*-===//
+//
+// The inputs of the incremental mode, see CallIndex::setChangedFiles.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SHOW_CALL_CHANGEDFILES_H
+#define SHOW_CALL_CHANGEDFILES_H
+
+#include "llvm/ADT/StringRef.h"
+
+#include <string>
+#include <vector>
+
+namespace clang {
+namespace showcall {
+
+/// \brief Returns \p Path made absolute, without "." nor ".." components,
+/// and with the symbolic links resolved, so that two names of the same file
+/// compare equal. A file which does not exist (e.g. deleted by a change) gets
+/// its directory resolved.
+std::string getCanonicalPath(llvm::StringRef Path);
+
+/// \brief Appends to \p Files the files listed in \p ListFile, one per line,
+/// made canonical (see getCanonicalPath) relative to the current directory.
+///
+/// \returns false, with the reason in \p Error, if \p ListFile cannot be read.
+bool readChangedFiles(llvm::StringRef ListFile,
+                      std::vector<std::string> &Files, std::string &Error);
+
+/// \brief Appends to \p Files the canonical paths of the files changed in
+/// \p Revisions, as given to `git diff`: e.g. "HEAD~3..HEAD", or
+/// "origin/master" to include the changes of the working tree. The untracked
+/// files of the working tree, which may shadow an include, are added too.
+///
+/// \returns false, with the reason in \p Error, if git failed.
+bool getGitChangedFiles(llvm::StringRef Revisions,
+                        std::vector<std::string> &Files, std::string &Error);
+
+} // end namespace showcall
+} // end namespace clang
+
+#endif // SHOW_CALL_CHANGEDFILES_H
@@ -0,0 +1,333 @@
+//===-- CompileCommandsIndex.cpp - Fast compile_commands.json loads -------===//
+//
+// All integers are little endian. The index is made of:
+//
+//   header   "scdbidx1", u64 JSON size, u64 JSON modification time (ns),
+//            u32 number of entries, u32 number of buckets (a power of 2)
+//   buckets  u32 first entry + 1 of each bucket, 0 if empty
+//   entries  u32 next entry + 1 in the bucket, u32 file offset, u32 file
+//            length, u32 command offset; one entry per compile command
+//   blob     the strings, and the commands: u32 directory offset, u32
+//            directory length, u32 number of arguments, then the offset and
+//            length of each argument
+//
+// Offsets are relative to the start of the blob.
+//
+//===----------------------------------------------------------------------===//
+
+#include "CompileCommandsIndex.h"
+
+#include "clang/Tooling/JSONCompilationDatabase.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <limits>
+
+using namespace clang::tooling;
+using namespace llvm;
+
+namespace clang {
+namespace showcall {
+
+namespace {
+const char IndexMagic[] = "scdbidx1";
+const size_t HeaderSize = 8 + 8 + 8 + 4 + 4;
+
+// FNV-1a, as the index must hash the same way in every run.
+uint32_t hashFileName(StringRef Name) {
+  uint32_t Hash = 2166136261u;
+  for (unsigned char C : Name) {
+    Hash ^= C;
+    Hash *= 16777619u;
+  }
+  return Hash;
+}
+
+void writeU32(raw_ostream &OS, uint32_t V) {
+  char Bytes[4] = { char(V), char(V >> 8), char(V >> 16), char(V >> 24) };
+  OS.write(Bytes, 4);
+}
+
+void writeU64(raw_ostream &OS, uint64_t V) {
+  writeU32(OS, uint32_t(V));
+  writeU32(OS, uint32_t(V >> 32));
+}
+
+uint32_t readU32(const char *P) {
+  const unsigned char *U = reinterpret_cast<const unsigned char *>(P);
+  return uint32_t(U[0]) | uint32_t(U[1]) << 8 | uint32_t(U[2]) << 16 |
+         uint32_t(U[3]) << 24;
+}
+
+uint64_t readU64(const char *P) {
+  return uint64_t(readU32(P)) | uint64_t(readU32(P + 4)) << 32;
+}
+
+// Number of trailing path components A and B have in common.
+unsigned getCommonSuffixLength(StringRef A, StringRef B) {
+  unsigned Length = 0;
+  for (sys::path::reverse_iterator IA = sys::path::rbegin(A),
+                                   EA = sys::path::rend(A),
+                                   IB = sys::path::rbegin(B),
+                                   EB = sys::path::rend(B);
+       IA != EA && IB != EB && *IA == *IB; ++IA, ++IB)
+    ++Length;
+  return Length;
+}
+
+bool getJSONStamp(StringRef JSONPath, uint64_t &Size, uint64_t &MTime) {
+  sys::fs::file_status Status;
+  if (sys::fs::status(JSONPath, Status))
+    return false;
+  sys::TimeValue Time = Status.getLastModificationTime();
+  Size = Status.getSize();
+  MTime = uint64_t(Time.toEpochTime()) * 1000000000 + Time.nanoseconds();
+  return true;
+}
+
+bool isUpToDate(const MemoryBuffer &Buffer, uint64_t Size, uint64_t MTime) {
+  StringRef Data = Buffer.getBuffer();
+  if (Data.size() < HeaderSize || !Data.startswith(IndexMagic) ||
+      readU64(Data.data() + 8) != Size || readU64(Data.data() + 16) != MTime)
+    return false;
+  uint64_t NumEntries = readU32(Data.data() + 24);
+  uint64_t NumBuckets = readU32(Data.data() + 28);
+  return NumBuckets != 0 && (NumBuckets & (NumBuckets - 1)) == 0 &&
+         HeaderSize + 4 * NumBuckets + 16 * NumEntries <= Data.size();
+}
+
+bool writeIndex(const CompilationDatabase &Database, uint64_t Size,
+                uint64_t MTime, StringRef IndexPath) {
+  std::string Blob;
+  raw_string_ostream BlobOS(Blob);
+  auto addString = [&](StringRef S) {
+    uint32_t Offset = BlobOS.tell();
+    BlobOS << S;
+    return Offset;
+  };
+
+  std::vector<uint32_t> Hashes;
+  std::vector<uint32_t> EntryFields;
+  for (const std::string &File : Database.getAllFiles()) {
+    uint32_t FileOffset = addString(File);
+    for (const CompileCommand &Command : Database.getCompileCommands(File)) {
+      std::vector<std::pair<uint32_t, uint32_t> > Strings;
+      Strings.push_back(std::make_pair(addString(Command.Directory),
+                                       uint32_t(Command.Directory.size())));
+      for (const std::string &Arg : Command.CommandLine)
+        Strings.push_back(std::make_pair(addString(Arg), uint32_t(Arg.size())));
+
+      uint32_t CommandOffset = BlobOS.tell();
+      writeU32(BlobOS, Strings[0].first);
+      writeU32(BlobOS, Strings[0].second);
+      writeU32(BlobOS, Strings.size() - 1);
+      for (size_t I = 1, E = Strings.size(); I != E; ++I) {
+        writeU32(BlobOS, Strings[I].first);
+        writeU32(BlobOS, Strings[I].second);
+      }
+
+      Hashes.push_back(hashFileName(sys::path::filename(File)));
+      EntryFields.push_back(0);
+      EntryFields.push_back(FileOffset);
+      EntryFields.push_back(File.size());
+      EntryFields.push_back(CommandOffset);
+    }
+  }
+  BlobOS.flush();
+  if (Blob.size() > std::numeric_limits<uint32_t>::max())
+    return false;
+
+  uint32_t NumEntries = Hashes.size();
+  uint32_t NumBuckets = 1;
+  while (NumBuckets < NumEntries)
+    NumBuckets *= 2;
+  // Chain backwards, so that the commands of a file keep their order.
+  std::vector<uint32_t> Buckets(NumBuckets, 0);
+  for (uint32_t I = NumEntries; I != 0; --I) {
+    uint32_t &Head = Buckets[Hashes[I - 1] & (NumBuckets - 1)];
+    EntryFields[4 * (I - 1)] = Head;
+    Head = I;
+  }
+
+  // Write to a temporary file first, so that concurrent runs only ever see
+  // a complete index.
+  int FD;
+  SmallString<256> TempPath;
+  if (sys::fs::createUniqueFile(IndexPath + "-%%%%%%%%.tmp", FD, TempPath))
+    return false;
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << IndexMagic;
+    writeU64(OS, Size);
+    writeU64(OS, MTime);
+    writeU32(OS, NumEntries);
+    writeU32(OS, NumBuckets);
+    for (uint32_t Head : Buckets)
+      writeU32(OS, Head);
+    for (uint32_t Field : EntryFields)
+      writeU32(OS, Field);
+    OS << Blob;
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      sys::fs::remove(TempPath.str());
+      return false;
+    }
+  }
+  if (sys::fs::rename(TempPath.str(), IndexPath)) {
+    sys::fs::remove(TempPath.str());
+    return false;
+  }
+  return true;
+}
+} // end anonymous namespace
+
+std::string findJSONCompilationDatabase(StringRef Directory,
+                                        bool SearchParents) {
+  SmallString<256> Dir(Directory);
+  sys::fs::make_absolute(Dir);
+  for (StringRef D = Dir; !D.empty(); D = sys::path::parent_path(D)) {
+    SmallString<256> Path(D);
+    sys::path::append(Path, "compile_commands.json");
+    if (sys::fs::exists(Path.str()))
+      return Path.str();
+    if (!SearchParents)
+      break;
+  }
+  return std::string();
+}
+
+std::unique_ptr<CompilationDatabase>
+IndexedCompilationDatabase::load(StringRef JSONPath, StringRef IndexPath,
+                                 std::string &Error) {
+  uint64_t Size, MTime;
+  if (!getJSONStamp(JSONPath, Size, MTime)) {
+    Error = "cannot stat " + JSONPath.str();
+    return nullptr;
+  }
+
+  ErrorOr<std::unique_ptr<MemoryBuffer>> Buffer = MemoryBuffer::getFile(
+      IndexPath, /*FileSize=*/-1, /*RequiresNullTerminator=*/false);
+  if (Buffer && isUpToDate(**Buffer, Size, MTime))
+    return std::unique_ptr<CompilationDatabase>(
+        new IndexedCompilationDatabase(std::move(*Buffer)));
+
+  // Parse the JSON file this time, and index it for the next runs.
+  std::unique_ptr<CompilationDatabase> JSON(
+      JSONCompilationDatabase::loadFromFile(JSONPath, Error));
+  if (!JSON)
+    return nullptr;
+  if (!writeIndex(*JSON, Size, MTime, IndexPath))
+    llvm::errs() << "warning: cannot write " << IndexPath << ".\n";
+  return JSON;
+}
+
+IndexedCompilationDatabase::IndexedCompilationDatabase(
+    std::unique_ptr<MemoryBuffer> Buffer)
+    : Buffer(std::move(Buffer)) {
+  const char *Data = this->Buffer->getBufferStart();
+  NumEntries = readU32(Data + 24);
+  NumBuckets = readU32(Data + 28);
+  Buckets = Data + HeaderSize;
+  Entries = Buckets + 4 * NumBuckets;
+  Blob = Entries + 16 * NumEntries;
+}
+
+IndexedCompilationDatabase::Entry
+IndexedCompilationDatabase::getEntry(uint32_t I) const {
+  const char *P = Entries + 16 * I;
+  Entry E = { readU32(P), readU32(P + 4), readU32(P + 8), readU32(P + 12) };
+  return E;
+}
+
+StringRef IndexedCompilationDatabase::getString(uint32_t Offset,
+                                                uint32_t Length) const {
+  return StringRef(Blob + Offset, Length);
+}
+
+CompileCommand IndexedCompilationDatabase::getCommand(const Entry &E) const {
+  const char *P = Blob + E.CommandOffset;
+  StringRef Directory = getString(readU32(P), readU32(P + 4));
+  uint32_t NumArgs = readU32(P + 8);
+  std::vector<std::string> CommandLine;
+  CommandLine.reserve(NumArgs);
+  for (uint32_t I = 0; I != NumArgs; ++I) {
+    const char *Arg = P + 12 + 8 * I;
+    CommandLine.push_back(getString(readU32(Arg), readU32(Arg + 4)));
+  }
+  return CompileCommand(Directory, std::move(CommandLine));
+}
+
+std::vector<CompileCommand>
+IndexedCompilationDatabase::getCompileCommands(StringRef FilePath) const {
+  SmallString<256> NativePath;
+  sys::path::native(FilePath, NativePath);
+  uint32_t Bucket =
+      hashFileName(sys::path::filename(NativePath)) & (NumBuckets - 1);
+
+  // An exact match wins. Otherwise, like the FileMatchTrie of
+  // JSONCompilationDatabase, take the file with the longest common suffix
+  // among those which are the same file on disk, and give up on ties.
+  StringRef Best;
+  unsigned BestLength = 0;
+  bool Ambiguous = false;
+  for (uint32_t I = readU32(Buckets + 4 * Bucket); I != 0;
+       I = getEntry(I - 1).Next) {
+    Entry E = getEntry(I - 1);
+    StringRef File = getString(E.FileOffset, E.FileLength);
+    if (File == NativePath) {
+      Best = File;
+      Ambiguous = false;
+      break;
+    }
+    if (File == Best)
+      continue;
+    unsigned Length = getCommonSuffixLength(File, NativePath);
+    bool Equivalent;
+    if (Length == 0 || Length < BestLength ||
+        sys::fs::equivalent(File, NativePath.str(), Equivalent) || !Equivalent)
+      continue;
+    Ambiguous = Length == BestLength;
+    Best = File;
+    BestLength = Length;
+  }
+
+  std::vector<CompileCommand> Commands;
+  if (Best.empty() || Ambiguous)
+    return Commands;
+  for (uint32_t I = readU32(Buckets + 4 * Bucket); I != 0;
+       I = getEntry(I - 1).Next) {
+    Entry E = getEntry(I - 1);
+    if (getString(E.FileOffset, E.FileLength) == Best)
+      Commands.push_back(getCommand(E));
+  }
+  return Commands;
+}
+
+std::vector<std::string> IndexedCompilationDatabase::getAllFiles() const {
+  // The commands of a file are consecutive.
+  std::vector<std::string> Files;
+  StringRef Last;
+  for (uint32_t I = 0; I != NumEntries; ++I) {
+    Entry E = getEntry(I);
+    StringRef File = getString(E.FileOffset, E.FileLength);
+    if (I == 0 || File != Last)
+      Files.push_back(File);
+    Last = File;
+  }
+  return Files;
+}
+
+std::vector<CompileCommand>
+IndexedCompilationDatabase::getAllCompileCommands() const {
+  std::vector<CompileCommand> Commands;
+  Commands.reserve(NumEntries);
+  for (uint32_t I = 0; I != NumEntries; ++I)
+    Commands.push_back(getCommand(getEntry(I)));
+  return Commands;
+}
+
+} // end namespace showcall
+} // end namespace clang
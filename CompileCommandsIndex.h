@@ -0,0 +1,81 @@
+//===-- CompileCommandsIndex.h - Fast compile_commands.json loads -*- C++ -*-=//
+//
+// Parsing a big compile_commands.json, and matching the source paths against
+// all its files, can take longer than a single file query itself. The index
+// is a binary copy of the database, built once and mapped by the next runs,
+// with a hash table of the files keyed by file name. It is rebuilt whenever
+// the size or the modification time of the JSON file changes.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SHOW_CALL_COMPILECOMMANDSINDEX_H
+#define SHOW_CALL_COMPILECOMMANDSINDEX_H
+
+#include "clang/Tooling/CompilationDatabase.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace clang {
+namespace showcall {
+
+/// \brief Returns the path of the compile_commands.json in \p Directory, or
+/// in its closest parent holding one if \p SearchParents, like
+/// CompilationDatabase::autoDetectFromSource does. Returns an empty string
+/// if there is none.
+std::string findJSONCompilationDatabase(llvm::StringRef Directory,
+                                        bool SearchParents);
+
+/// \brief A compilation database read from an index of a
+/// compile_commands.json.
+///
+/// Lookups match the file name through the hash table, then pick the file
+/// of the database with the longest path suffix in common with the query,
+/// the way JSONCompilationDatabase does.
+class IndexedCompilationDatabase : public tooling::CompilationDatabase {
+public:
+  /// \brief Loads the database \p JSONPath from the index \p IndexPath.
+  ///
+  /// A missing or outdated index is built from \p JSONPath, and the parsed
+  /// JSON database is returned for this run. Returns null, with the reason
+  /// in \p Error, if \p JSONPath cannot be loaded.
+  static std::unique_ptr<tooling::CompilationDatabase>
+  load(llvm::StringRef JSONPath, llvm::StringRef IndexPath,
+       std::string &Error);
+
+  std::vector<tooling::CompileCommand>
+  getCompileCommands(llvm::StringRef FilePath) const override;
+  std::vector<std::string> getAllFiles() const override;
+  std::vector<tooling::CompileCommand> getAllCompileCommands() const override;
+
+private:
+  struct Entry {
+    uint32_t Next;
+    uint32_t FileOffset;
+    uint32_t FileLength;
+    uint32_t CommandOffset;
+  };
+
+  explicit IndexedCompilationDatabase(
+      std::unique_ptr<llvm::MemoryBuffer> Buffer);
+
+  Entry getEntry(uint32_t I) const;
+  llvm::StringRef getString(uint32_t Offset, uint32_t Length) const;
+  tooling::CompileCommand getCommand(const Entry &E) const;
+
+  std::unique_ptr<llvm::MemoryBuffer> Buffer;
+  uint32_t NumEntries;
+  uint32_t NumBuckets;
+  const char *Buckets;
+  const char *Entries;
+  const char *Blob;
+};
+
+} // end namespace showcall
+} // end namespace clang
+
+#endif // SHOW_CALL_COMPILECOMMANDSINDEX_H
@@ -0,0 +1,126 @@
+//===-- Diff.cpp - Compare the calls of two configurations ----------------===//
+
+#include "Diff.h"
+
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <map>
+
+using namespace clang::tooling;
+using namespace llvm;
+
+namespace clang {
+namespace showcall {
+
+std::vector<CompileCommand> ExtraArgsCompilationDatabase::adjust(
+    std::vector<CompileCommand> Commands) const {
+  for (CompileCommand &Command : Commands)
+    Command.CommandLine.insert(Command.CommandLine.end(), ExtraArgs.begin(),
+                               ExtraArgs.end());
+  return Commands;
+}
+
+std::vector<CompileCommand>
+ExtraArgsCompilationDatabase::getCompileCommands(StringRef FilePath) const {
+  return adjust(Base.getCompileCommands(FilePath));
+}
+
+std::vector<std::string> ExtraArgsCompilationDatabase::getAllFiles() const {
+  return Base.getAllFiles();
+}
+
+std::vector<CompileCommand>
+ExtraArgsCompilationDatabase::getAllCompileCommands() const {
+  return adjust(Base.getAllCompileCommands());
+}
+
+namespace {
+struct DiffSite {
+  const CallRecord *First;
+  std::vector<std::string> Callees[2];
+
+  DiffSite() : First(nullptr) {}
+};
+
+void addCallees(const CallRecord &Record, std::vector<std::string> &Callees) {
+  // Defaulted callees of the same type only differ by their name.
+  Callees.push_back(Record.getCalleeKey());
+  Callees.insert(Callees.end(), Record.InstantiationCallees.begin(),
+                 Record.InstantiationCallees.end());
+}
+
+void writeText(raw_ostream &OS, const DiffSite &Site) {
+  const CallRecord &R = *Site.First;
+  OS << "Call site: " << R.CallText << " @ " << R.FileName << ':' << R.Line
+     << '\n';
+  static const char *const Prefixes[] = {"- ", "+ "};
+  for (unsigned Side = 0; Side != 2; ++Side) {
+    if (Site.Callees[Side].empty())
+      OS << Prefixes[Side] << "No call\n";
+    for (const std::string &Callee : Site.Callees[Side])
+      OS << Prefixes[Side] << "Callee: " << Callee << '\n';
+  }
+  OS << '\n';
+}
+
+void writeJSONLines(raw_ostream &OS, const DiffSite &Site) {
+  const CallRecord &R = *Site.First;
+  OS << "{\"kind\":";
+  writeJSONString(OS, R.Kind);
+  OS << ",\"call\":";
+  writeJSONString(OS, R.CallText);
+  OS << ",\"file\":";
+  writeJSONString(OS, R.FileName);
+  OS << ",\"line\":" << R.Line << ",\"column\":" << R.Column;
+  static const char *const Keys[] = {",\"callees_a\":[", ",\"callees_b\":["};
+  for (unsigned Side = 0; Side != 2; ++Side) {
+    OS << Keys[Side];
+    for (size_t I = 0, E = Site.Callees[Side].size(); I != E; ++I) {
+      if (I)
+        OS << ',';
+      writeJSONString(OS, Site.Callees[Side][I]);
+    }
+    OS << ']';
+  }
+  OS << "}\n";
+}
+} // end anonymous namespace
+
+size_t writeCallDiff(ArrayRef<CallRecord> A, ArrayRef<CallRecord> B,
+                     OutputFormat Format, const DiffSiteFilter &Accept,
+                     raw_ostream &OS) {
+  // Ordered by file and offset, for a stable output.
+  std::map<std::pair<StringRef, unsigned>, DiffSite> Sites;
+  ArrayRef<CallRecord> Records[] = {A, B};
+  for (unsigned Side = 0; Side != 2; ++Side) {
+    for (const CallRecord &Record : Records[Side]) {
+      DiffSite &Site = Sites[std::make_pair(StringRef(Record.FileName),
+                                            Record.Offset)];
+      if (!Site.First)
+        Site.First = &Record;
+      addCallees(Record, Site.Callees[Side]);
+    }
+  }
+
+  size_t Written = 0;
+  for (auto &Entry : Sites) {
+    DiffSite &Site = Entry.second;
+    for (std::vector<std::string> &Callees : Site.Callees) {
+      std::sort(Callees.begin(), Callees.end());
+      Callees.erase(std::unique(Callees.begin(), Callees.end()),
+                    Callees.end());
+    }
+    if (Site.Callees[0] == Site.Callees[1] || !Accept(*Site.First))
+      continue;
+    if (Format == OF_JSONLines)
+      writeJSONLines(OS, Site);
+    else
+      writeText(OS, Site);
+    ++Written;
+  }
+  return Written;
+}
+
+} // end namespace showcall
+} // end namespace clang
@@ -0,0 +1,73 @@
+//===-- Diff.h - Compare the calls of two configurations -------*- C++ -*-===//
+//
+// Which calls resolve differently with -std=c++14 and -std=c++20, or with
+// and without some macro? The --diff mode parses every source file under two
+// configurations at once, and only prints the call sites whose callees are
+// not the same in both, instead of two full outputs to compare.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SHOW_CALL_DIFF_H
+#define SHOW_CALL_DIFF_H
+
+#include "CallRecord.h"
+#include "OutputWriter.h"
+
+#include "clang/Tooling/CompilationDatabase.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace llvm {
+class raw_ostream;
+}
+
+namespace clang {
+namespace showcall {
+
+/// \brief The compile commands of \p Base, with \p ExtraArgs appended, so
+/// that they override the flags of \p Base.
+class ExtraArgsCompilationDatabase : public tooling::CompilationDatabase {
+public:
+  ExtraArgsCompilationDatabase(const tooling::CompilationDatabase &Base,
+                               std::vector<std::string> ExtraArgs)
+      : Base(Base), ExtraArgs(std::move(ExtraArgs)) {}
+
+  std::vector<tooling::CompileCommand>
+  getCompileCommands(llvm::StringRef FilePath) const override;
+  std::vector<std::string> getAllFiles() const override;
+  std::vector<tooling::CompileCommand> getAllCompileCommands() const override;
+
+private:
+  std::vector<tooling::CompileCommand>
+  adjust(std::vector<tooling::CompileCommand> Commands) const;
+
+  const tooling::CompilationDatabase &Base;
+  std::vector<std::string> ExtraArgs;
+};
+
+/// \brief Tells whether to print a differing call site, given its record
+/// in either configuration, e.g. to print the header calls once.
+typedef std::function<bool(const CallRecord &)> DiffSiteFilter;
+
+/// \brief Writes to \p OS, in \p Format, the call sites of a source file
+/// whose callees differ between \p A and \p B, its call records in the two
+/// configurations. The calls only found in one of them are written too.
+///
+/// Call sites are compared by file and offset, which the calls of a template
+/// (one per instantiation) or of a macro expanded several times share, so
+/// the callees of a site are compared as sets. Only \p Format OF_Text and
+/// OF_JSONLines are supported.
+///
+/// \returns the number of call sites written.
+size_t writeCallDiff(llvm::ArrayRef<CallRecord> A,
+                     llvm::ArrayRef<CallRecord> B, OutputFormat Format,
+                     const DiffSiteFilter &Accept, llvm::raw_ostream &OS);
+
+} // end namespace showcall
+} // end namespace clang
+
+#endif // SHOW_CALL_DIFF_H
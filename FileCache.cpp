@@ -0,0 +1,130 @@
+//===-- FileCache.cpp - Run wide cache of file system accesses ------------===//
+
+#include "FileCache.h"
+
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/Path.h"
+
+using namespace llvm;
+
+namespace clang {
+namespace showcall {
+
+namespace {
+// Hands out views of a buffer owned by the CachingFileSystem, which outlives
+// the FileManagers using it.
+class CachedFile : public vfs::File {
+public:
+  CachedFile(const vfs::Status &S, const MemoryBuffer &Contents)
+      : S(S), Contents(Contents) {}
+
+  ErrorOr<vfs::Status> status() override { return S; }
+
+  ErrorOr<std::unique_ptr<MemoryBuffer>>
+  getBuffer(const Twine &Name, int64_t FileSize, bool RequiresNullTerminator,
+            bool IsVolatile) override {
+    return MemoryBuffer::getMemBuffer(Contents.getBuffer(), Name.str(),
+                                      RequiresNullTerminator);
+  }
+
+  std::error_code close() override { return std::error_code(); }
+
+  void setName(StringRef Name) override { S.setName(Name); }
+
+private:
+  vfs::Status S;
+  const MemoryBuffer &Contents;
+};
+} // end anonymous namespace
+
+CachingFileSystem::CachingFileSystem(IntrusiveRefCntPtr<vfs::FileSystem> Base,
+                                     bool CacheContents)
+    : Base(Base), CacheContents(CacheContents) {}
+
+CachingFileSystem::~CachingFileSystem() {}
+
+CachingFileSystem::Shard &CachingFileSystem::getShard(StringRef Path) {
+  return Shards[hash_value(Path) % NumShards];
+}
+
+ErrorOr<vfs::Status> CachingFileSystem::status(const Twine &Path) {
+  SmallString<256> Storage;
+  StringRef P = Path.toStringRef(Storage);
+  if (!sys::path::is_absolute(P))
+    return Base->status(Path);
+
+  Shard &S = getShard(P);
+  {
+    std::lock_guard<std::mutex> Lock(S.Mutex);
+    auto I = S.Statuses.find(P.str());
+    if (I != S.Statuses.end()) {
+      if (I->second.Error)
+        return I->second.Error;
+      return I->second.Status;
+    }
+  }
+
+  ErrorOr<vfs::Status> Result = Base->status(P);
+  StatusEntry Entry;
+  if (Result)
+    Entry.Status = *Result;
+  else
+    Entry.Error = Result.getError();
+  std::lock_guard<std::mutex> Lock(S.Mutex);
+  S.Statuses.insert(std::make_pair(P.str(), Entry));
+  return Result;
+}
+
+ErrorOr<std::unique_ptr<vfs::File>>
+CachingFileSystem::openFileForRead(const Twine &Path) {
+  SmallString<256> Storage;
+  StringRef P = Path.toStringRef(Storage);
+  if (!sys::path::is_absolute(P) || !CacheContents)
+    return Base->openFileForRead(Path);
+
+  Shard &S = getShard(P);
+  {
+    std::lock_guard<std::mutex> Lock(S.Mutex);
+    auto I = S.Contents.find(P.str());
+    if (I != S.Contents.end())
+      return std::unique_ptr<vfs::File>(
+          new CachedFile(I->second.Status, *I->second.Contents));
+  }
+
+  // Read without holding the lock. Should another thread read the same file
+  // meanwhile, the first copy to make it to the cache wins.
+  ErrorOr<std::unique_ptr<vfs::File>> File = Base->openFileForRead(P);
+  if (!File)
+    return File.getError();
+  ErrorOr<vfs::Status> Status = (*File)->status();
+  if (!Status)
+    return Status.getError();
+  ErrorOr<std::unique_ptr<MemoryBuffer>> Buffer =
+      (*File)->getBuffer(P, Status->getSize(),
+                         /*RequiresNullTerminator=*/true,
+                         /*IsVolatile=*/false);
+  (*File)->close();
+  if (!Buffer)
+    return Buffer.getError();
+
+  std::lock_guard<std::mutex> Lock(S.Mutex);
+  ContentsEntry &Entry = S.Contents[P.str()];
+  if (!Entry.Contents) {
+    Entry.Status = *Status;
+    Entry.Contents = std::move(*Buffer);
+  }
+  StatusEntry Stat;
+  Stat.Status = *Status;
+  S.Statuses.insert(std::make_pair(P.str(), Stat));
+  return std::unique_ptr<vfs::File>(
+      new CachedFile(Entry.Status, *Entry.Contents));
+}
+
+vfs::directory_iterator CachingFileSystem::dir_begin(const Twine &Dir,
+                                                     std::error_code &EC) {
+  return Base->dir_begin(Dir, EC);
+}
+
+} // end namespace showcall
+} // end namespace clang
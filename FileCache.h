@@ -0,0 +1,71 @@
+//===-- FileCache.h - Run wide cache of file system accesses ----*- C++ -*-===//
+//
+// Each translation unit gets its own FileManager, whose stat and file caches
+// die with it: the same system and project headers end up being looked up
+// and read again for every source file. CachingFileSystem sits between those
+// FileManagers and the real file system, so that each header is looked up
+// and read once per run.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SHOW_CALL_FILECACHE_H
+#define SHOW_CALL_FILECACHE_H
+
+#include "clang/Basic/VirtualFileSystem.h"
+#include "llvm/ADT/IntrusiveRefCntPtr.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace clang {
+namespace showcall {
+
+/// \brief A thread safe file system caching the status and, unless
+/// \p CacheContents is false, the contents of the files of \p Base.
+///
+/// Failed lookups are cached too, as header search probes many missing
+/// files. Only absolute paths are cached; files are assumed not to change
+/// during the run.
+class CachingFileSystem : public vfs::FileSystem {
+public:
+  explicit CachingFileSystem(IntrusiveRefCntPtr<vfs::FileSystem> Base,
+                             bool CacheContents = true);
+  ~CachingFileSystem();
+
+  llvm::ErrorOr<vfs::Status> status(const llvm::Twine &Path) override;
+  llvm::ErrorOr<std::unique_ptr<vfs::File>>
+  openFileForRead(const llvm::Twine &Path) override;
+  vfs::directory_iterator dir_begin(const llvm::Twine &Dir,
+                                    std::error_code &EC) override;
+
+private:
+  struct StatusEntry {
+    std::error_code Error;
+    vfs::Status Status;
+  };
+  struct ContentsEntry {
+    vfs::Status Status;
+    std::unique_ptr<llvm::MemoryBuffer> Contents;
+  };
+  // Workers mostly look up different files at the same time.
+  enum { NumShards = 32 };
+  struct Shard {
+    std::mutex Mutex;
+    std::unordered_map<std::string, StatusEntry> Statuses;
+    std::unordered_map<std::string, ContentsEntry> Contents;
+  };
+
+  Shard &getShard(llvm::StringRef Path);
+
+  IntrusiveRefCntPtr<vfs::FileSystem> Base;
+  bool CacheContents;
+  Shard Shards[NumShards];
+};
+
+} // end namespace showcall
+} // end namespace clang
+
+#endif // SHOW_CALL_FILECACHE_H
@@ -0,0 +1,84 @@
+//===-- OutputPipeline.cpp - Format and write records on a thread ---------===//
+
+#include "OutputPipeline.h"
+#include "OutputWriter.h"
+
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+namespace clang {
+namespace showcall {
+
+OutputPipeline::OutputPipeline(OutputWriter &Writer, raw_ostream &Out,
+                               size_t NumPaths)
+    : Writer(Writer), Out(Out), Slots(NumPaths), Next(0), ClosedAhead(0),
+      Thread(&OutputPipeline::run, this) {}
+
+OutputPipeline::~OutputPipeline() { finish(); }
+
+void OutputPipeline::add(size_t Index, CallRecord Record) {
+  Slot &S = Slots[Index];
+  S.Current.push_back(std::move(Record));
+  if (S.Current.size() == BatchSize)
+    push(S, /*Close=*/false);
+}
+
+void OutputPipeline::close(size_t Index) {
+  push(Slots[Index], /*Close=*/true);
+  // The writer only makes progress on a closed path: the path it waits for
+  // may not even be started, and then nothing is held up.
+  std::unique_lock<std::mutex> Lock(Mutex);
+  Written.wait(Lock, [&] {
+    return Index <= Next || ClosedAhead <= MaxClosedAhead ||
+           !Slots[Next].Closed;
+  });
+}
+
+void OutputPipeline::push(Slot &S, bool Close) {
+  {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    if (!S.Current.empty()) {
+      S.Ready.push_back(Batch());
+      S.Ready.back().swap(S.Current);
+    }
+    if (Close && !S.Closed)
+      ++ClosedAhead;
+    S.Closed |= Close;
+  }
+  Changed.notify_one();
+}
+
+void OutputPipeline::finish() {
+  if (Thread.joinable())
+    Thread.join();
+}
+
+void OutputPipeline::run() {
+  std::unique_lock<std::mutex> Lock(Mutex);
+  while (Next != Slots.size()) {
+    Slot &S = Slots[Next];
+    Changed.wait(Lock, [&] { return !S.Ready.empty() || S.Closed; });
+    if (S.Ready.empty()) {
+      // Closed, and everything written.
+      ++Next;
+      --ClosedAhead;
+      Lock.unlock();
+      Written.notify_all();
+      Out.flush();
+      Lock.lock();
+      continue;
+    }
+
+    std::vector<Batch> Batches;
+    Batches.swap(S.Ready);
+    Lock.unlock();
+    for (const Batch &B : Batches)
+      for (const CallRecord &Record : B)
+        Writer.write(Record);
+    Lock.lock();
+  }
+}
+
+} // end namespace showcall
+} // end namespace clang
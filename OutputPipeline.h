@@ -0,0 +1,98 @@
+//===-- OutputPipeline.h - Format and write records on a thread -*- C++ -*-===//
+//
+// Formatting and writing the records of a translation unit need not hold up
+// the parse of the next one. The workers only hand their records over to an
+// OutputPipeline, whose own thread formats and writes them, in the order of
+// the source paths, while the workers go on parsing.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SHOW_CALL_OUTPUTPIPELINE_H
+#define SHOW_CALL_OUTPUTPIPELINE_H
+
+#include "CallRecord.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace llvm {
+class raw_ostream;
+}
+
+namespace clang {
+namespace showcall {
+
+class OutputWriter;
+
+/// \brief Writes the records of a list of source paths with \p Writer, from a
+/// thread of its own.
+///
+/// The records of each path are written in the order they were added, and
+/// the paths one after the other, in index order: the records of a path
+/// stream out as soon as all the paths before it are closed.
+class OutputPipeline {
+public:
+  OutputPipeline(OutputWriter &Writer, llvm::raw_ostream &Out,
+                 size_t NumPaths);
+  /// \brief Calls finish().
+  ~OutputPipeline();
+
+  /// \brief Queues \p Record, found in the path \p Index. Only the thread
+  /// processing that path may call this.
+  void add(size_t Index, CallRecord Record);
+
+  /// \brief Tells that the path \p Index has no more records.
+  ///
+  /// When the writer falls behind, with more than MaxClosedAhead closed
+  /// paths waiting, this blocks until it catches up: the records held back
+  /// stay bounded by those of the paths in progress and of the waiting
+  /// ones. runOnSourcePaths bounds the paths done ahead of one in progress.
+  void close(size_t Index);
+
+  /// \brief Waits until every record is written. All the paths must be
+  /// closed.
+  void finish();
+
+private:
+  OutputPipeline(const OutputPipeline &) = delete;
+  void operator=(const OutputPipeline &) = delete;
+
+  /// Records are handed over in batches, so that the workers rarely take
+  /// the lock.
+  enum { BatchSize = 64 };
+  /// How many closed paths may wait for the writer.
+  enum { MaxClosedAhead = 64 };
+  typedef std::vector<CallRecord> Batch;
+
+  struct Slot {
+    /// Only touched by the thread processing the path.
+    Batch Current;
+    /// Guarded by Mutex.
+    std::vector<Batch> Ready;
+    bool Closed;
+
+    Slot() : Closed(false) {}
+  };
+
+  void push(Slot &S, bool Close);
+  void run();
+
+  OutputWriter &Writer;
+  llvm::raw_ostream &Out;
+  std::vector<Slot> Slots;
+  std::mutex Mutex;
+  std::condition_variable Changed;
+  std::condition_variable Written;
+  /// The path being written.
+  size_t Next;
+  /// The closed paths from Next on.
+  size_t ClosedAhead;
+  std::thread Thread;
+};
+
+} // end namespace showcall
+} // end namespace clang
+
+#endif // SHOW_CALL_OUTPUTPIPELINE_H
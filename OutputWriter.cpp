@@ -0,0 +1,156 @@
+//===-- OutputWriter.cpp - Format call records ----------------------------===//
+
+#include "OutputWriter.h"
+#include "BinaryOutput.h"
+#include "CallRecord.h"
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+namespace clang {
+namespace showcall {
+
+OutputWriter::~OutputWriter() {}
+
+void writeJSONString(raw_ostream &OS, StringRef S) {
+  OS << '"';
+  for (char C : S) {
+    switch (C) {
+    case '"':  OS << "\\\""; break;
+    case '\\': OS << "\\\\"; break;
+    case '\n': OS << "\\n"; break;
+    case '\t': OS << "\\t"; break;
+    default:
+      if (static_cast<unsigned char>(C) < 0x20)
+        OS << format("\\u%04x", static_cast<unsigned char>(C));
+      else
+        OS << C;
+    }
+  }
+  OS << '"';
+}
+
+namespace {
+class TextWriter : public OutputWriter {
+public:
+  explicit TextWriter(raw_ostream &OS) : OutputWriter(OS) {}
+
+  void write(const CallRecord &R) override {
+    OS << "Call site: " << R.CallText << " @ " << R.FileName << ':' << R.Line
+       << '\n';
+    OS << R.CallAST;
+    OS << "Callee: " << R.getCalleeDescription() << '\n';
+    for (const std::string &Callee : R.InstantiationCallees)
+      OS << "Callee: " << Callee << '\n';
+    OS << R.CalleeAST;
+    OS << '\n';
+  }
+};
+
+class JSONLinesWriter : public OutputWriter {
+public:
+  explicit JSONLinesWriter(raw_ostream &OS) : OutputWriter(OS) {}
+
+  void write(const CallRecord &R) override {
+    OS << "{\"kind\":";
+    writeString(R.Kind);
+    OS << ",\"call\":";
+    writeString(R.CallText);
+    OS << ",\"file\":";
+    writeString(R.FileName);
+    OS << ",\"line\":" << R.Line << ",\"column\":" << R.Column
+       << ",\"callee\":";
+    writeString(R.CalleeName);
+    OS << ",\"type\":";
+    writeString(R.CalleeType);
+    OS << ",\"callee_file\":";
+    writeString(R.CalleeFileName);
+    OS << ",\"callee_line\":" << R.CalleeLine
+       << ",\"defaulted\":" << (R.CalleeDefaulted ? "true" : "false");
+    if (!R.InstantiationCallees.empty()) {
+      OS << ",\"instantiation_callees\":[";
+      for (size_t I = 0, E = R.InstantiationCallees.size(); I != E; ++I) {
+        if (I)
+          OS << ',';
+        writeString(R.InstantiationCallees[I]);
+      }
+      OS << ']';
+    }
+    if (!R.CallAST.empty()) {
+      OS << ",\"call_ast\":";
+      writeString(R.CallAST);
+    }
+    if (!R.CalleeAST.empty()) {
+      OS << ",\"callee_ast\":";
+      writeString(R.CalleeAST);
+    }
+    OS << "}\n";
+  }
+
+private:
+  void writeString(StringRef S) { writeJSONString(OS, S); }
+};
+
+// RFC 4180 style. The AST dumps are not part of this format.
+class CSVWriter : public OutputWriter {
+public:
+  explicit CSVWriter(raw_ostream &OS) : OutputWriter(OS) {}
+
+  void writeHeader() override {
+    OS << "kind,call,file,line,column,callee,type,callee_file,callee_line,"
+          "defaulted\n";
+  }
+
+  void write(const CallRecord &R) override {
+    OS << R.Kind << ',';
+    writeField(R.CallText);
+    OS << ',';
+    writeField(R.FileName);
+    OS << ',' << R.Line << ',' << R.Column << ',';
+    writeField(R.CalleeName);
+    OS << ',';
+    writeField(R.CalleeType);
+    OS << ',';
+    writeField(R.CalleeFileName);
+    OS << ',' << R.CalleeLine << ',' << (R.CalleeDefaulted ? '1' : '0')
+       << '\n';
+  }
+
+private:
+  void writeField(StringRef S) {
+    if (S.find_first_of(",\"\r\n") == StringRef::npos) {
+      OS << S;
+      return;
+    }
+    OS << '"';
+    for (char C : S) {
+      if (C == '"')
+        OS << '"';
+      OS << C;
+    }
+    OS << '"';
+  }
+};
+} // end anonymous namespace
+
+std::unique_ptr<OutputWriter> OutputWriter::create(OutputFormat Format,
+                                                   raw_ostream &OS) {
+  switch (Format) {
+  case OF_Text:
+    return std::unique_ptr<OutputWriter>(new TextWriter(OS));
+  case OF_JSONLines:
+    return std::unique_ptr<OutputWriter>(new JSONLinesWriter(OS));
+  case OF_CSV:
+    return std::unique_ptr<OutputWriter>(new CSVWriter(OS));
+  case OF_Binary:
+    return createBinaryWriter(OS);
+  }
+  llvm_unreachable("Unknown output format");
+}
+
+} // end namespace showcall
+} // end namespace clang
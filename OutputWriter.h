@@ -0,0 +1,63 @@
+//===-- OutputWriter.h - Format call records --------------------*- C++ -*-===//
+//
+// Writers turning CallRecords into one of the supported output formats.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SHOW_CALL_OUTPUTWRITER_H
+#define SHOW_CALL_OUTPUTWRITER_H
+
+#include "llvm/ADT/StringRef.h"
+
+#include <memory>
+
+namespace llvm {
+class raw_ostream;
+}
+
+namespace clang {
+namespace showcall {
+
+struct CallRecord;
+
+enum OutputFormat {
+  OF_Text,      ///< Human readable, the historical show-call output.
+  OF_JSONLines, ///< One JSON object per call site.
+  OF_CSV,       ///< Comma separated values, with a header line.
+  OF_Binary     ///< String tables and fixed size records, see BinaryOutput.h.
+};
+
+/// \brief Formats call records to a stream.
+///
+/// Writers do no buffering of their own: they are meant to write to a
+/// buffered stream, e.g. the per file buffers of runOnSourcePaths, or a
+/// raw_fd_ostream.
+class OutputWriter {
+public:
+  virtual ~OutputWriter();
+
+  /// \brief Writes whatever the format needs once, before any record.
+  virtual void writeHeader() {}
+
+  /// \brief Writes a single call record.
+  virtual void write(const CallRecord &Record) = 0;
+
+  /// \brief Writes whatever the format needs once, after the last record.
+  virtual void writeFooter() {}
+
+  static std::unique_ptr<OutputWriter> create(OutputFormat Format,
+                                              llvm::raw_ostream &OS);
+
+protected:
+  explicit OutputWriter(llvm::raw_ostream &OS) : OS(OS) {}
+
+  llvm::raw_ostream &OS;
+};
+
+/// \brief Writes \p S as a quoted and escaped JSON string.
+void writeJSONString(llvm::raw_ostream &OS, llvm::StringRef S);
+
+} // end namespace showcall
+} // end namespace clang
+
+#endif // SHOW_CALL_OUTPUTWRITER_H
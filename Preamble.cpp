@@ -0,0 +1,295 @@
+//===-- Preamble.cpp - Precompiled headers for the include prefix ---------===//
+//
+// For a key K, the cache directory holds:
+//
+//   K.h     the text of the preamble,
+//   K.pch   the precompiled header built from K.h,
+//   K.deps  "<md5> <tab> <absolute path>" for each file K.pch was built from.
+//
+// The main file is then parsed with -include-pch K.pch, and its preamble
+// replaced by blanks so that offsets, lines and columns do not change.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Preamble.h"
+#include "CallIndex.h"
+
+#include "clang/Basic/FileManager.h"
+#include "clang/Frontend/CompilerInstance.h"
+#include "clang/Frontend/CompilerInvocation.h"
+#include "clang/Frontend/FrontendActions.h"
+#include "clang/Frontend/FrontendOptions.h"
+#include "clang/Lex/HeaderSearchOptions.h"
+#include "clang/Lex/Lexer.h"
+#include "clang/Lex/PreprocessorOptions.h"
+#include "clang/Tooling/Tooling.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace clang::tooling;
+using namespace llvm;
+
+namespace clang {
+namespace showcall {
+
+namespace {
+class PreambleAction : public ToolAction {
+public:
+  PreambleAction(PreambleCache &Cache, ToolAction &Action)
+      : Cache(Cache), Action(Action) { }
+
+  bool runInvocation(CompilerInvocation *Invocation, FileManager *Files,
+                     DiagnosticConsumer *DiagConsumer) override {
+    Cache.usePreamble(*Invocation, *Files, DiagConsumer);
+    return Action.runInvocation(Invocation, Files, DiagConsumer);
+  }
+
+private:
+  PreambleCache &Cache;
+  ToolAction &Action;
+};
+
+// Builds the precompiled header, and records which files it read.
+class BuildPreambleAction : public GeneratePCHAction {
+public:
+  explicit BuildPreambleAction(std::vector<IndexDependency> &Deps)
+      : Deps(Deps) { }
+
+protected:
+  void EndSourceFileAction() override {
+    collectDependencies(getCompilerInstance().getSourceManager(), Deps);
+    GeneratePCHAction::EndSourceFileAction();
+  }
+
+private:
+  std::vector<IndexDependency> &Deps;
+};
+
+void updateHash(MD5 &Hash, StringRef Data) {
+  Hash.update(Data);
+  Hash.update(StringRef("", 1));
+}
+
+// Everything which changes how the preamble parses: the language, target and
+// macros (all part of the module hash), the include paths, and the directory
+// quoted includes are first looked up in.
+std::string getKey(const CompilerInvocation &Invocation, StringRef MainDir,
+                   StringRef Preamble) {
+  MD5 Hash;
+  updateHash(Hash, Invocation.getModuleHash());
+  for (const HeaderSearchOptions::Entry &Entry :
+       Invocation.getHeaderSearchOpts().UserEntries) {
+    updateHash(Hash, Entry.Path);
+    updateHash(Hash, std::to_string(unsigned(Entry.Group)));
+    updateHash(Hash, Entry.IsFramework ? "F" : "D");
+  }
+  for (const std::string &Include : Invocation.getPreprocessorOpts().Includes)
+    updateHash(Hash, Include);
+  updateHash(Hash, MainDir);
+  updateHash(Hash, Preamble);
+  MD5::MD5Result Result;
+  Hash.final(Result);
+  SmallString<32> Str;
+  MD5::stringifyResult(Result, Str);
+  return Str.str();
+}
+
+// Writes Contents to FileName through a temporary file, so that concurrent
+// readers, including other show-call processes, never see a partial file.
+bool writeFileAtomically(StringRef Directory, StringRef FileName,
+                         StringRef Contents) {
+  SmallString<256> Model(Directory);
+  sys::path::append(Model, "preamble-%%%%%%%%.tmp");
+  int FD;
+  SmallString<256> TempPath;
+  if (sys::fs::createUniqueFile(Model, FD, TempPath))
+    return false;
+
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << Contents;
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      sys::fs::remove(TempPath.str());
+      return false;
+    }
+  }
+
+  if (sys::fs::rename(TempPath.str(), FileName)) {
+    sys::fs::remove(TempPath.str());
+    return false;
+  }
+  return true;
+}
+} // end anonymous namespace
+
+PreambleCache::PreambleCache(StringRef Directory) {
+  SmallString<256> Path(Directory);
+  sys::fs::make_absolute(Path);
+  this->Directory = Path.str();
+}
+
+std::unique_ptr<ToolAction> PreambleCache::wrap(ToolAction &Action) {
+  return std::unique_ptr<ToolAction>(new PreambleAction(*this, Action));
+}
+
+std::string PreambleCache::getPath(StringRef Key, StringRef Extension) const {
+  SmallString<256> Path(Directory);
+  sys::path::append(Path, Key + Extension);
+  return Path.str();
+}
+
+PreambleCache::KeyState &PreambleCache::getKeyState(StringRef Key) {
+  std::lock_guard<std::mutex> Lock(KeysMutex);
+  std::unique_ptr<KeyState> &State = Keys[Key];
+  if (!State)
+    State.reset(new KeyState);
+  return *State;
+}
+
+bool PreambleCache::isUpToDate(StringRef Key) const {
+  if (!sys::fs::exists(getPath(Key, ".pch")) ||
+      !sys::fs::exists(getPath(Key, ".h")))
+    return false;
+  ErrorOr<std::unique_ptr<MemoryBuffer>> Buffer =
+      MemoryBuffer::getFile(getPath(Key, ".deps"));
+  if (!Buffer)
+    return false;
+
+  StringRef Line, Rest = (*Buffer)->getBuffer();
+  while (!Rest.empty()) {
+    std::tie(Line, Rest) = Rest.split('\n');
+    StringRef Hash, FileName;
+    std::tie(Hash, FileName) = Line.split('\t');
+    if (FileName.empty() || hashFile(FileName) != Hash)
+      return false;
+  }
+  return true;
+}
+
+bool PreambleCache::build(const CompilerInvocation &Invocation,
+                          FileManager &Files, DiagnosticConsumer *DiagConsumer,
+                          StringRef Key, StringRef MainDir,
+                          StringRef Preamble) {
+  if (sys::fs::create_directories(Directory))
+    return false;
+  std::string HeaderPath = getPath(Key, ".h");
+  if (!writeFileAtomically(Directory, HeaderPath, Preamble.str() + "\n"))
+    return false;
+
+  IntrusiveRefCntPtr<CompilerInvocation> PCHInvocation(
+      new CompilerInvocation(Invocation));
+  FrontendOptions &FrontendOpts = PCHInvocation->getFrontendOpts();
+  InputKind Kind = FrontendOpts.Inputs[0].getKind();
+  FrontendOpts.Inputs.clear();
+  FrontendOpts.Inputs.push_back(FrontendInputFile(HeaderPath, Kind));
+  FrontendOpts.ProgramAction = frontend::GeneratePCH;
+  // Written to a temporary file and renamed by the CompilerInstance.
+  FrontendOpts.OutputFile = getPath(Key, ".pch");
+  // The header is not next to the main file: resolve its quoted includes
+  // from the directory of the main file first, as they would have been.
+  std::vector<HeaderSearchOptions::Entry> &UserEntries =
+      PCHInvocation->getHeaderSearchOpts().UserEntries;
+  UserEntries.insert(UserEntries.begin(),
+                     HeaderSearchOptions::Entry(MainDir, frontend::Quoted,
+                                                /*IsFramework=*/false,
+                                                /*IgnoreSysRoot=*/false));
+
+  CompilerInstance Compiler;
+  Compiler.setInvocation(PCHInvocation.get());
+  Compiler.setFileManager(&Files);
+  Compiler.createDiagnostics(DiagConsumer, /*ShouldOwnClient=*/false);
+  if (!Compiler.hasDiagnostics())
+    return false;
+  Compiler.createSourceManager(Files);
+
+  std::vector<IndexDependency> Deps;
+  BuildPreambleAction Action(Deps);
+  bool Success = Compiler.ExecuteAction(Action) &&
+                 !Compiler.getDiagnostics().hasErrorOccurred();
+  Files.clearStatCaches();
+  if (!Success)
+    return false;
+
+  // The header itself is part of the key.
+  std::string DepsContents;
+  raw_string_ostream OS(DepsContents);
+  for (const IndexDependency &Dep : Deps)
+    if (Dep.FileName != HeaderPath)
+      OS << Dep.Hash << '\t' << Dep.FileName << '\n';
+  return writeFileAtomically(Directory, getPath(Key, ".deps"), OS.str());
+}
+
+bool PreambleCache::usePreamble(CompilerInvocation &Invocation,
+                                FileManager &Files,
+                                DiagnosticConsumer *DiagConsumer) {
+  FrontendOptions &FrontendOpts = Invocation.getFrontendOpts();
+  PreprocessorOptions &PPOpts = Invocation.getPreprocessorOpts();
+  if (FrontendOpts.Inputs.size() != 1 || !PPOpts.ImplicitPCHInclude.empty() ||
+      !PPOpts.ImplicitPTHInclude.empty())
+    return false;
+
+  std::string MainFile = FrontendOpts.Inputs[0].getFile();
+  const FileEntry *Entry = Files.getFile(MainFile);
+  if (!Entry)
+    return false;
+  ErrorOr<std::unique_ptr<MemoryBuffer>> Buffer = Files.getBufferForFile(Entry);
+  if (!Buffer)
+    return false;
+  StringRef Contents = (*Buffer)->getBuffer();
+  unsigned PreambleSize =
+      Lexer::ComputePreamble(Contents, *Invocation.getLangOpts()).first;
+  if (PreambleSize == 0)
+    return false;
+  StringRef Preamble = Contents.substr(0, PreambleSize);
+
+  SmallString<256> MainPath(MainFile);
+  Files.FixupRelativePath(MainPath);
+  sys::fs::make_absolute(MainPath);
+  StringRef MainDir = sys::path::parent_path(MainPath);
+  std::string Key = getKey(Invocation, MainDir, Preamble);
+
+  KeyState &State = getKeyState(Key);
+  {
+    std::lock_guard<std::mutex> Lock(State.Mutex);
+    if (!State.Checked) {
+      State.Checked = true;
+      State.Usable =
+          isUpToDate(Key) ||
+          build(Invocation, Files, DiagConsumer, Key, MainDir, Preamble);
+      if (!State.Usable)
+        llvm::errs() << "warning: cannot precompile the preamble of "
+                     << MainPath << ", parsing it in full.\n";
+    }
+    if (!State.Usable)
+      return false;
+  }
+
+  // Blank the preamble out rather than removing it, so that the locations
+  // of the rest of the file are unchanged.
+  // The buffer is written in place, instead of copying a blanked string.
+  std::unique_ptr<MemoryBuffer> Blanked =
+      MemoryBuffer::getNewUninitMemBuffer(Contents.size(), MainFile);
+  char *Data = const_cast<char *>(Blanked->getBufferStart());
+  for (unsigned I = 0; I != PreambleSize; ++I)
+    Data[I] = Contents[I] == '\n' || Contents[I] == '\r' ? Contents[I] : ' ';
+  std::copy(Contents.begin() + PreambleSize, Contents.end(),
+            Data + PreambleSize);
+  PPOpts.addRemappedFile(MainFile, Blanked.release());
+  PPOpts.ImplicitPCHInclude = getPath(Key, ".pch");
+  // isUpToDate already checked the files the precompiled header depends on;
+  // the original file name it records, K.h, is not the main file.
+  PPOpts.DisablePCHValidation = true;
+  return true;
+}
+
+} // end namespace showcall
+} // end namespace clang
@@ -0,0 +1,85 @@
+//===-- Preamble.h - Precompiled headers for the include prefix -*- C++ -*-===//
+//
+// Most source files start with the same block of #includes, and parsing the
+// headers dominates their parse time. PreambleCache precompiles that block,
+// the preamble, once per set of compile flags, and has every translation
+// unit starting with it load the precompiled header instead of parsing it
+// again. The precompiled headers are kept on disk, so that later runs reuse
+// them too.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SHOW_CALL_PREAMBLE_H
+#define SHOW_CALL_PREAMBLE_H
+
+#include "llvm/ADT/StringRef.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace clang {
+class CompilerInvocation;
+class DiagnosticConsumer;
+class FileManager;
+
+namespace tooling {
+class ToolAction;
+}
+
+namespace showcall {
+
+/// \brief A thread safe, on-disk cache of precompiled preambles.
+///
+/// A preamble is keyed by the options affecting how it parses, the directory
+/// of the file it comes from (for quoted includes) and its text. Each entry
+/// records the files the preamble included and their hashes, and is rebuilt
+/// when any of them changed.
+class PreambleCache {
+public:
+  explicit PreambleCache(llvm::StringRef Directory);
+
+  /// \brief Returns an action running \p Action with the preamble of the main
+  /// file taken from the cache, after building it if needed. Translation
+  /// units without a preamble, or whose preamble cannot be precompiled, are
+  /// parsed as usual.
+  std::unique_ptr<tooling::ToolAction> wrap(tooling::ToolAction &Action);
+
+  /// \brief Changes \p Invocation to load the precompiled preamble of its
+  /// main file. Returns false, leaving \p Invocation alone, if there is none.
+  bool usePreamble(CompilerInvocation &Invocation, FileManager &Files,
+                   DiagnosticConsumer *DiagConsumer);
+
+private:
+  PreambleCache(const PreambleCache &) = delete;
+  void operator=(const PreambleCache &) = delete;
+
+  bool isUpToDate(llvm::StringRef Key) const;
+  bool build(const CompilerInvocation &Invocation, FileManager &Files,
+             DiagnosticConsumer *DiagConsumer, llvm::StringRef Key,
+             llvm::StringRef MainDir, llvm::StringRef Preamble);
+  std::string getPath(llvm::StringRef Key, llvm::StringRef Extension) const;
+
+  /// Serializes the checks and builds of a given preamble, so that the
+  /// translation units sharing it wait for it instead of all building it.
+  /// Files are assumed not to change during the run, so each preamble is
+  /// only checked or built once.
+  struct KeyState {
+    std::mutex Mutex;
+    bool Checked;
+    bool Usable;
+    KeyState() : Checked(false), Usable(false) {}
+  };
+  KeyState &getKeyState(llvm::StringRef Key);
+
+  /// Absolute, as it is handed to compilers running in other directories.
+  std::string Directory;
+  std::mutex KeysMutex;
+  std::map<std::string, std::unique_ptr<KeyState> > Keys;
+};
+
+} // end namespace showcall
+} // end namespace clang
+
+#endif // SHOW_CALL_PREAMBLE_H
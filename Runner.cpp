@@ -0,0 +1,446 @@
+//===-- Runner.cpp - Run show-call over many translation units ------------===//
+//
+// ClangTool::run processes its source files one after the other, and chdir()s
+// into the directory of each compile command, which makes it impossible to
+// use from several threads. The helpers here build the tool invocations
+// themselves, resolving relative paths against the compile command directory
+// through the driver's -working-directory option instead.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Runner.h"
+
+#include "clang/Basic/FileManager.h"
+#include "clang/Basic/FileSystemOptions.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/Basic/VirtualFileSystem.h"
+#include "clang/Tooling/ArgumentsAdjusters.h"
+#include "clang/Tooling/CompilationDatabase.h"
+#include "clang/Tooling/Tooling.h"
+#include "llvm/ADT/IntrusiveRefCntPtr.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+using namespace clang;
+using namespace clang::tooling;
+using namespace llvm;
+
+namespace clang {
+namespace showcall {
+
+namespace {
+// Used to locate the clang resource directory (builtin headers) relative to
+// the show-call executable, just like ClangTool does.
+int StaticSymbol;
+
+const std::string &getMainExecutable() {
+  static const std::string MainExecutable =
+      llvm::sys::fs::getMainExecutable("show-call", &StaticSymbol);
+  return MainExecutable;
+}
+
+std::vector<std::string> adjustCommandLine(const CompileCommand &Command) {
+  std::vector<std::string> CommandLine = getClangSyntaxOnlyAdjuster()(
+      getClangStripOutputAdjuster()(Command.CommandLine));
+  assert(!CommandLine.empty());
+  CommandLine[0] = getMainExecutable();
+  // Let the driver and the frontend resolve relative paths, instead of
+  // changing the working directory of the whole process.
+  CommandLine.insert(CommandLine.begin() + 1, "-working-directory");
+  CommandLine.insert(CommandLine.begin() + 2, Command.Directory);
+  return CommandLine;
+}
+} // end anonymous namespace
+
+bool runOnCompileCommand(const CompileCommand &Command, ToolAction &Action,
+                         vfs::FileSystem *FS) {
+  FileSystemOptions FileSystemOpts;
+  FileSystemOpts.WorkingDir = Command.Directory;
+  IntrusiveRefCntPtr<FileManager> Files(
+      new FileManager(FileSystemOpts, IntrusiveRefCntPtr<vfs::FileSystem>(FS)));
+
+  ToolInvocation Invocation(adjustCommandLine(Command), &Action, Files.get());
+  return Invocation.run();
+}
+
+bool runOnSourcePath(const CompilationDatabase &Compilations,
+                     StringRef SourcePath, ToolAction &Action,
+                     vfs::FileSystem *FS) {
+  std::string File(getAbsolutePath(SourcePath));
+  std::vector<CompileCommand> CompileCommands =
+      Compilations.getCompileCommands(File);
+  if (CompileCommands.empty()) {
+    llvm::errs() << "Skipping " << File << ". Compile command not found.\n";
+    return false;
+  }
+
+  bool Success = true;
+  for (const CompileCommand &Command : CompileCommands) {
+    if (!runOnCompileCommand(Command, Action, FS)) {
+      llvm::errs() << "Error while processing " << File << ".\n";
+      Success = false;
+    }
+  }
+  return Success;
+}
+
+std::string getAbsoluteFileName(const SourceManager &SM, StringRef FileName) {
+  SmallString<256> Path(FileName);
+  SM.getFileManager().FixupRelativePath(Path);
+  llvm::sys::fs::make_absolute(Path);
+  return Path.str();
+}
+
+bool CostModel::load(StringRef FileName) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> Buffer =
+      MemoryBuffer::getFile(FileName);
+  if (!Buffer)
+    return Buffer.getError() == std::errc::no_such_file_or_directory;
+
+  StringRef Line, Rest = (*Buffer)->getBuffer();
+  while (!Rest.empty()) {
+    std::tie(Line, Rest) = Rest.split('\n');
+    StringRef Seconds, Path;
+    std::tie(Seconds, Path) = Line.split('\t');
+    if (Path.empty())
+      continue;
+    Times[Path.str()] = std::strtod(Seconds.str().c_str(), nullptr);
+  }
+  return true;
+}
+
+bool CostModel::save(StringRef FileName) const {
+  std::error_code EC;
+  raw_fd_ostream OS(FileName, EC, sys::fs::F_Text);
+  if (EC)
+    return false;
+  for (const auto &Time : Times)
+    OS << format("%.6f", Time.second) << '\t' << Time.first << '\n';
+  OS.close();
+  if (OS.has_error()) {
+    OS.clear_error();
+    return false;
+  }
+  return true;
+}
+
+void CostModel::record(StringRef SourcePath, double Seconds) {
+  Times[getAbsolutePath(SourcePath)] = Seconds;
+}
+
+std::vector<double>
+CostModel::estimate(ArrayRef<std::string> SourcePaths) const {
+  std::vector<double> Costs(SourcePaths.size(), -1);
+  std::vector<uint64_t> Sizes(SourcePaths.size(), 0);
+  double KnownTime = 0, KnownSize = 0;
+  for (size_t I = 0, E = SourcePaths.size(); I != E; ++I) {
+    sys::fs::file_size(SourcePaths[I], Sizes[I]);
+    std::map<std::string, double>::const_iterator Time =
+        Times.find(getAbsolutePath(SourcePaths[I]));
+    if (Time == Times.end())
+      continue;
+    Costs[I] = Time->second;
+    if (Sizes[I]) {
+      KnownTime += Time->second;
+      KnownSize += Sizes[I];
+    }
+  }
+
+  // Only the order matters when nothing is known.
+  double TimePerByte = KnownSize ? KnownTime / KnownSize : 1e-6;
+  for (size_t I = 0, E = SourcePaths.size(); I != E; ++I)
+    if (Costs[I] < 0)
+      Costs[I] = Sizes[I] * TimePerByte;
+  return Costs;
+}
+
+namespace {
+// How much finished output runOnSourcePaths holds back, waiting for the
+// paths before it: at least this many paths (more with many threads), and
+// this many bytes.
+const size_t MinHeldBackPaths = 16;
+const size_t MaxHeldBackBytes = 64 << 20;
+
+// The resident memory of the process, in bytes, or 0 where unknown.
+uint64_t getResidentMemory() {
+#ifdef __linux__
+  std::FILE *Statm = std::fopen("/proc/self/statm", "r");
+  if (!Statm)
+    return 0;
+  unsigned long long Size, Resident;
+  int Read = std::fscanf(Statm, "%llu %llu", &Size, &Resident);
+  std::fclose(Statm);
+  if (Read != 2)
+    return 0;
+  return Resident * sysconf(_SC_PAGESIZE);
+#else
+  return 0;
+#endif
+}
+
+// Gives the memory freed by a finished translation unit back to the system,
+// so that the resident size tells what the running ones use.
+void releaseFreeMemory() {
+#ifdef __GLIBC__
+  malloc_trim(0);
+#endif
+}
+
+// Holds back the workers about to start a path while the process is above
+// its memory limit, as long as another path is in progress: the running
+// translation units finish, and free their memory, before others start.
+//
+// The resident size also counts the output held back for the paths before
+// it, which finishing a translation unit does not free. That output has
+// its own bound (MaxHeldBackBytes), so past the limit the throttle comes
+// down to one path at a time rather than waiting on it.
+class MemoryThrottle {
+public:
+  explicit MemoryThrottle(uint64_t MaxRSS) : MaxRSS(MaxRSS), Running(0) {}
+
+  void start() {
+    std::unique_lock<std::mutex> Lock(Mutex);
+    if (MaxRSS)
+      Finished.wait(Lock, [&] {
+        return Running == 0 || getResidentMemory() <= MaxRSS;
+      });
+    ++Running;
+  }
+
+  void finish() {
+    if (MaxRSS)
+      releaseFreeMemory();
+    {
+      std::lock_guard<std::mutex> Lock(Mutex);
+      --Running;
+    }
+    Finished.notify_all();
+  }
+
+private:
+  uint64_t MaxRSS;
+  std::mutex Mutex;
+  std::condition_variable Finished;
+  /// The number of paths in progress.
+  unsigned Running;
+};
+
+// One queue of source path indices per worker, most costly first. Paths are
+// dealt out up front to the least loaded worker, biggest first; a worker
+// whose queue is empty steals the biggest path of the most loaded one, which
+// makes up for wrong estimates.
+//
+// Each call to next() starts a whole translation unit, so a single lock for
+// all the queues is not a bottleneck.
+class WorkQueues {
+public:
+  WorkQueues(size_t NumPaths, size_t NumWorkers, ArrayRef<double> Costs)
+      : Queues(NumWorkers), Loads(NumWorkers, 0), Costs(Costs) {
+    std::vector<size_t> Order(NumPaths);
+    for (size_t I = 0; I != NumPaths; ++I)
+      Order[I] = I;
+
+    // Without estimates everything goes to the first queue, and all workers
+    // take from it in input order.
+    if (Costs.empty()) {
+      Queues[0].assign(Order.begin(), Order.end());
+      Loads[0] = NumPaths;
+      return;
+    }
+
+    std::stable_sort(Order.begin(), Order.end(), [&](size_t A, size_t B) {
+      return Costs[A] > Costs[B];
+    });
+    for (size_t I : Order) {
+      size_t Worker =
+          std::min_element(Loads.begin(), Loads.end()) - Loads.begin();
+      Queues[Worker].push_back(I);
+      Loads[Worker] += getCost(I);
+    }
+  }
+
+  /// \brief Sets \p Index to the next path \p Worker should process.
+  ///
+  /// \returns false when there is nothing left to do.
+  bool next(size_t Worker, size_t &Index) {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    size_t From = Worker;
+    if (Queues[Worker].empty()) {
+      From = Queues.size();
+      for (size_t W = 0; W != Queues.size(); ++W)
+        if (!Queues[W].empty() &&
+            (From == Queues.size() || Loads[W] > Loads[From]))
+          From = W;
+      if (From == Queues.size())
+        return false;
+    }
+    Index = Queues[From].front();
+    Queues[From].pop_front();
+    Loads[From] -= getCost(Index);
+    return true;
+  }
+
+  /// \brief Takes the path \p Index out of the queues, wherever it is.
+  ///
+  /// \returns false if it was already taken.
+  bool take(size_t Index) {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    for (size_t W = 0; W != Queues.size(); ++W) {
+      std::deque<size_t>::iterator I =
+          std::find(Queues[W].begin(), Queues[W].end(), Index);
+      if (I == Queues[W].end())
+        continue;
+      Queues[W].erase(I);
+      Loads[W] -= getCost(Index);
+      return true;
+    }
+    return false;
+  }
+
+private:
+  double getCost(size_t Index) const {
+    return Costs.empty() ? 1 : Costs[Index];
+  }
+
+  std::mutex Mutex;
+  std::vector<std::deque<size_t> > Queues;
+  /// The estimated cost of what is left in each queue.
+  std::vector<double> Loads;
+  ArrayRef<double> Costs;
+};
+} // end anonymous namespace
+
+int runOnSourcePaths(ArrayRef<std::string> SourcePaths, unsigned Jobs,
+                     const SourceProcessor &Process, raw_ostream &Out,
+                     ArrayRef<double> Costs, std::vector<double> *Times,
+                     uint64_t MaxRSS) {
+  struct Slot {
+    std::string Output;
+    bool Started;
+    bool Done;
+    Slot() : Started(false), Done(false) {}
+  };
+  std::vector<Slot> Slots(SourcePaths.size());
+  std::mutex OutMutex;
+  std::condition_variable Flushed;
+  size_t NextFlush = 0;
+  // The paths done but waiting for the ones before them, and the size of
+  // their output.
+  size_t HeldBack = 0;
+  size_t HeldBackBytes = 0;
+  bool Failed = false;
+  if (Times)
+    Times->assign(SourcePaths.size(), 0);
+
+  if (Jobs == 0)
+    Jobs = std::max(1u, std::thread::hardware_concurrency());
+  size_t NumThreads =
+      std::max<size_t>(1, std::min<size_t>(Jobs, SourcePaths.size()));
+  // Alone, a worker processes the paths in order, so that the results
+  // stream out as they come.
+  if (NumThreads == 1)
+    Costs = None;
+  assert((Costs.empty() || Costs.size() == SourcePaths.size()) &&
+         "One cost per source path expected");
+  WorkQueues Queues(SourcePaths.size(), NumThreads, Costs);
+  MemoryThrottle Throttle(NumThreads > 1 ? MaxRSS : 0);
+  size_t MaxHeldBack = std::max<size_t>(MinHeldBackPaths, 4 * NumThreads);
+
+  // Once too much output is held back, the paths after the first one not
+  // flushed yet wait: a worker either starts that one, or waits for it to
+  // be done.
+  auto Next = [&](size_t ID, size_t &I) {
+    std::unique_lock<std::mutex> Lock(OutMutex);
+    auto IsFull = [&] {
+      return HeldBack >= MaxHeldBack || HeldBackBytes >= MaxHeldBackBytes;
+    };
+    Flushed.wait(Lock, [&] {
+      return !IsFull() || !Slots[NextFlush].Started;
+    });
+    if (IsFull()) {
+      I = NextFlush;
+      if (!Queues.take(I))
+        return false;
+    } else if (!Queues.next(ID, I)) {
+      return false;
+    }
+    Slots[I].Started = true;
+    return true;
+  };
+
+  auto Worker = [&](size_t ID) {
+    size_t I;
+    while (true) {
+      Throttle.start();
+      if (!Next(ID, I)) {
+        Throttle.finish();
+        break;
+      }
+      std::chrono::steady_clock::time_point Start =
+          std::chrono::steady_clock::now();
+      std::string Buffer;
+      raw_string_ostream OS(Buffer);
+      bool Success = Process(I, SourcePaths[I], OS);
+      OS.flush();
+      Throttle.finish();
+
+      {
+        std::lock_guard<std::mutex> Lock(OutMutex);
+        if (Times)
+          (*Times)[I] = std::chrono::duration<double>(
+                            std::chrono::steady_clock::now() - Start).count();
+        Failed |= !Success;
+        Slots[I].Output.swap(Buffer);
+        Slots[I].Done = true;
+        ++HeldBack;
+        HeldBackBytes += Slots[I].Output.size();
+        // Emit every finished path that is next in line, so that the output
+        // order does not depend on scheduling.
+        for (; NextFlush < Slots.size() && Slots[NextFlush].Done;
+             ++NextFlush) {
+          --HeldBack;
+          HeldBackBytes -= Slots[NextFlush].Output.size();
+          Out << Slots[NextFlush].Output;
+          std::string().swap(Slots[NextFlush].Output);
+        }
+        Out.flush();
+      }
+      Flushed.notify_all();
+    }
+  };
+
+  if (NumThreads == 1) {
+    Worker(0);
+  } else {
+    std::vector<std::thread> Threads;
+    for (size_t I = 0; I < NumThreads; ++I)
+      Threads.emplace_back(Worker, I);
+    for (std::thread &T : Threads)
+      T.join();
+  }
+
+  return Failed ? 1 : 0;
+}
+
+} // end namespace showcall
+} // end namespace clang
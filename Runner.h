@@ -0,0 +1,136 @@
+//===-- Runner.h - Run show-call over many translation units ----*- C++ -*-===//
+//
+// Helpers to run a frontend action over the compile commands of a list of
+// source files, possibly on several threads at once.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SHOW_CALL_RUNNER_H
+#define SHOW_CALL_RUNNER_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace llvm {
+class raw_ostream;
+}
+
+namespace clang {
+class SourceManager;
+
+namespace tooling {
+class CompilationDatabase;
+struct CompileCommand;
+class ToolAction;
+}
+
+namespace vfs {
+class FileSystem;
+}
+
+namespace showcall {
+
+/// \brief Runs \p Action over \p Command.
+///
+/// Unlike ClangTool::run, this never changes the working directory of the
+/// process: the compile command directory is handed to the driver and to the
+/// FileManager instead, so several calls can safely run concurrently.
+///
+/// Files are accessed through \p FS if not null, e.g. a CachingFileSystem
+/// shared by all the runs, or else through the real file system.
+///
+/// \returns false on failure.
+bool runOnCompileCommand(const tooling::CompileCommand &Command,
+                         tooling::ToolAction &Action,
+                         vfs::FileSystem *FS = nullptr);
+
+/// \brief Runs \p Action over every compile command found for \p SourcePath,
+/// see runOnCompileCommand.
+///
+/// \returns false if no compile command was found or if any of the runs
+/// failed.
+bool runOnSourcePath(const tooling::CompilationDatabase &Compilations,
+                     llvm::StringRef SourcePath, tooling::ToolAction &Action,
+                     vfs::FileSystem *FS = nullptr);
+
+/// \brief Returns the absolute path of \p FileName, a file of \p SM.
+///
+/// Files may be named relative to the directory of their compile command,
+/// which is not the current directory of show-call.
+std::string getAbsoluteFileName(const SourceManager &SM,
+                                llvm::StringRef FileName);
+
+/// \brief Processes a single source path, the one at \p Index in the list
+/// given to runOnSourcePaths, writing its results to the given stream.
+/// Returns false on failure.
+typedef std::function<bool(size_t Index, llvm::StringRef SourcePath,
+                           llvm::raw_ostream &OS)> SourceProcessor;
+
+/// \brief Estimates how long processing each source path takes, so that
+/// the biggest translation units do not start last.
+///
+/// Times measured by earlier runs are used when known. Other paths are
+/// estimated from their file size, scaled by the average time per byte of
+/// the known ones.
+class CostModel {
+public:
+  CostModel() {}
+
+  /// \brief Reads the times saved by an earlier run. A missing file is not
+  /// an error: there is simply nothing known yet.
+  bool load(llvm::StringRef FileName);
+
+  /// \brief Writes all known times, for the next runs.
+  bool save(llvm::StringRef FileName) const;
+
+  /// \brief Records that processing \p SourcePath took \p Seconds.
+  void record(llvm::StringRef SourcePath, double Seconds);
+
+  /// \brief Returns the estimated cost of each of \p SourcePaths.
+  std::vector<double> estimate(llvm::ArrayRef<std::string> SourcePaths) const;
+
+private:
+  /// Keyed by absolute path.
+  std::map<std::string, double> Times;
+};
+
+/// \brief Calls \p Process on each of \p SourcePaths, using up to \p Jobs
+/// threads (0 means one per hardware thread).
+///
+/// When \p Costs is given, with one estimate per source path, the paths are
+/// dealt out to the workers biggest first, each worker taking the most costly
+/// of its paths first; idle workers steal the biggest remaining path of the
+/// most loaded worker. The run then ends close to total work / \p Jobs,
+/// instead of waiting for a huge translation unit started last.
+///
+/// The output of each source path is buffered and written to \p Out in one
+/// go, in the order of \p SourcePaths, so results from different translation
+/// units never interleave. The wall time spent on each path is stored in
+/// \p Times, if not null.
+///
+/// Paths done before the ones preceding them are held back. Once a few times
+/// \p Jobs of them, or 64 MiB of output, are waiting, no path starts but the
+/// first one not written yet: the workers wait for it instead, and the output
+/// held back stays bounded however wrong the estimates are.
+///
+/// With a non zero \p MaxRSS, in bytes, no path starts while the resident
+/// memory of the process is above it, unless no other path is in progress:
+/// concurrency drops as memory runs short, down to a single path at a time.
+///
+/// \returns 0 on success, 1 if processing any of the paths failed.
+int runOnSourcePaths(llvm::ArrayRef<std::string> SourcePaths, unsigned Jobs,
+                     const SourceProcessor &Process, llvm::raw_ostream &Out,
+                     llvm::ArrayRef<double> Costs = llvm::None,
+                     std::vector<double> *Times = nullptr,
+                     uint64_t MaxRSS = 0);
+
+} // end namespace showcall
+} // end namespace clang
+
+#endif // SHOW_CALL_RUNNER_H
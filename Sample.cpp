@@ -0,0 +1,54 @@
+//===-- Sample.cpp - Process a random sample of the files -----------------===//
+
+#include "Sample.h"
+
+#include <algorithm>
+#include <numeric>
+
+using namespace llvm;
+
+namespace clang {
+namespace showcall {
+
+namespace {
+// FNV-1a, then the splitmix64 finalizer to spread the bits: std::hash and
+// llvm::hash_value are not guaranteed to be the same everywhere.
+uint64_t getRank(const std::string &Path, uint64_t Seed) {
+  uint64_t Hash = 0xcbf29ce484222325ULL ^ Seed;
+  for (unsigned char C : Path) {
+    Hash ^= C;
+    Hash *= 0x100000001b3ULL;
+  }
+  Hash ^= Hash >> 30;
+  Hash *= 0xbf58476d1ce4e5b9ULL;
+  Hash ^= Hash >> 27;
+  Hash *= 0x94d049bb133111ebULL;
+  Hash ^= Hash >> 31;
+  return Hash;
+}
+} // end anonymous namespace
+
+std::vector<size_t> selectSample(ArrayRef<std::string> SourcePaths,
+                                 size_t Count, uint64_t Seed) {
+  std::vector<uint64_t> Ranks;
+  Ranks.reserve(SourcePaths.size());
+  for (const std::string &Path : SourcePaths)
+    Ranks.push_back(getRank(Path, Seed));
+
+  std::vector<size_t> Order(SourcePaths.size());
+  std::iota(Order.begin(), Order.end(), 0);
+  std::sort(Order.begin(), Order.end(), [&](size_t A, size_t B) {
+    if (Ranks[A] != Ranks[B])
+      return Ranks[A] < Ranks[B];
+    return SourcePaths[A] != SourcePaths[B] ? SourcePaths[A] < SourcePaths[B]
+                                            : A < B;
+  });
+
+  std::vector<size_t> Positions(Order.begin(),
+                                Order.begin() + std::min(Count, Order.size()));
+  std::sort(Positions.begin(), Positions.end());
+  return Positions;
+}
+
+} // end namespace showcall
+} // end namespace clang
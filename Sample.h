@@ -0,0 +1,35 @@
+//===-- Sample.h - Process a random sample of the files ---------*- C++ -*-===//
+//
+// For a rough count of the calls to a callee, parsing every file of a big
+// compilation database is overkill. With --sample or --sample-files, a run
+// only processes a random sample of the files, and --summary extrapolates
+// its counts to all of them, see CallSummary::setSampled.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SHOW_CALL_SAMPLE_H
+#define SHOW_CALL_SAMPLE_H
+
+#include "llvm/ADT/ArrayRef.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace clang {
+namespace showcall {
+
+/// \brief Returns the positions in \p SourcePaths of a random sample of
+/// \p Count of them (all of them if there are fewer), in increasing order.
+///
+/// The sample only depends on \p Seed and on the set of paths, not on their
+/// order nor on the platform, so that a run can be reproduced. Each path is
+/// ranked by a hash of itself and the seed, and the lowest ranks are kept: a
+/// bigger sample with the same seed includes the smaller one.
+std::vector<size_t> selectSample(llvm::ArrayRef<std::string> SourcePaths,
+                                 size_t Count, uint64_t Seed);
+
+} // end namespace showcall
+} // end namespace clang
+
+#endif // SHOW_CALL_SAMPLE_H
@@ -0,0 +1,231 @@
+//===-- Server.cpp - Answer queries on resident ASTs ----------------------===//
+
+#include "Server.h"
+#include "CallFilter.h"
+#include "CallRecord.h"
+#include "Runner.h"
+
+#include "clang/AST/ASTContext.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/Frontend/ASTUnit.h"
+#include "clang/Frontend/CompilerInstance.h"
+#include "clang/Frontend/CompilerInvocation.h"
+#include "clang/Tooling/CompilationDatabase.h"
+#include "clang/Tooling/Tooling.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/TimeValue.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <istream>
+#include <vector>
+
+using namespace clang::ast_matchers;
+using namespace clang::tooling;
+using namespace llvm;
+
+namespace clang {
+namespace showcall {
+
+namespace {
+// Builds an ASTUnit from the invocation ToolInvocation prepared, the way
+// ClangTool::buildASTs does, but keeping the preamble so that reparses are
+// cheap.
+class ASTBuilderAction : public ToolAction {
+public:
+  explicit ASTBuilderAction(std::unique_ptr<ASTUnit> &AST) : AST(AST) { }
+
+  bool runInvocation(CompilerInvocation *Invocation, FileManager *Files,
+                     DiagnosticConsumer *DiagConsumer) override {
+    AST = ASTUnit::LoadFromCompilerInvocation(
+        Invocation,
+        CompilerInstance::createDiagnostics(&Invocation->getDiagnosticOpts(),
+                                            DiagConsumer,
+                                            /*ShouldOwnClient=*/false),
+        /*OnlyLocalDecls=*/false, /*CaptureDiagnostics=*/false,
+        /*PrecompilePreamble=*/true, TU_Complete,
+        /*CacheCodeCompletionResults=*/false,
+        /*IncludeBriefCommentsInCodeCompletion=*/false,
+        /*UserFilesAreVolatile=*/true);
+    return AST != nullptr;
+  }
+
+private:
+  std::unique_ptr<ASTUnit> &AST;
+};
+} // end anonymous namespace
+
+class CallServer::Unit {
+public:
+  explicit Unit(std::unique_ptr<ASTUnit> AST) : AST(std::move(AST)) {
+    updateStamps();
+  }
+
+  /// \brief Reparses the AST if any of its files changed since it was built.
+  bool refresh() {
+    if (!isOutOfDate())
+      return true;
+    if (AST->Reparse())
+      return false;
+    updateStamps();
+    return true;
+  }
+
+  ASTUnit &getAST() { return *AST; }
+
+private:
+  struct Stamp {
+    std::string FileName;
+    sys::TimeValue ModificationTime;
+    uint64_t Size;
+  };
+
+  void updateStamps() {
+    Stamps.clear();
+    const SourceManager &SM = AST->getSourceManager();
+    for (SourceManager::fileinfo_iterator I = SM.fileinfo_begin(),
+                                          E = SM.fileinfo_end();
+         I != E; ++I) {
+      Stamp S;
+      S.FileName = getAbsoluteFileName(SM, I->first->getName());
+      sys::fs::file_status Status;
+      if (sys::fs::status(S.FileName, Status))
+        continue;
+      S.ModificationTime = Status.getLastModificationTime();
+      S.Size = Status.getSize();
+      Stamps.push_back(std::move(S));
+    }
+  }
+
+  bool isOutOfDate() const {
+    for (const Stamp &S : Stamps) {
+      sys::fs::file_status Status;
+      if (sys::fs::status(S.FileName, Status) ||
+          Status.getLastModificationTime() != S.ModificationTime ||
+          Status.getSize() != S.Size)
+        return true;
+    }
+    return false;
+  }
+
+  std::unique_ptr<ASTUnit> AST;
+  std::vector<Stamp> Stamps;
+};
+
+CallServer::CallServer(const CompilationDatabase &Compilations,
+                       OutputFormat Format, const CallBackOptions &Options)
+    : Compilations(Compilations), Format(Format), Options(Options) {
+  // Never rewrite files from the server, and answer each query in full.
+  this->Options.Annotations = nullptr;
+  this->Options.SeenHeaderCalls = nullptr;
+  this->Options.ClaimedCallees = nullptr;
+}
+
+CallServer::~CallServer() {}
+
+CallServer::Unit *CallServer::getUnit(StringRef SourcePath,
+                                      std::string &Error) {
+  std::string File(getAbsolutePath(SourcePath));
+  std::unique_ptr<Unit> &U = Units[File];
+  if (U) {
+    if (!U->refresh()) {
+      Error = "cannot reparse " + File;
+      U.reset();
+      return nullptr;
+    }
+    return U.get();
+  }
+
+  // Only the first compile command of the file is used.
+  std::vector<CompileCommand> Commands = Compilations.getCompileCommands(File);
+  if (Commands.empty()) {
+    Error = "compile command not found for " + File;
+    return nullptr;
+  }
+  std::unique_ptr<ASTUnit> AST;
+  ASTBuilderAction Action(AST);
+  if (!runOnCompileCommand(Commands.front(), Action) || !AST) {
+    Error = "cannot parse " + File;
+    return nullptr;
+  }
+  U.reset(new Unit(std::move(AST)));
+  return U.get();
+}
+
+bool CallServer::preload(StringRef SourcePath) {
+  std::string Error;
+  if (getUnit(SourcePath, Error))
+    return true;
+  llvm::errs() << "error: " << Error << ".\n";
+  return false;
+}
+
+bool CallServer::handleRequest(StringRef Request, raw_ostream &Out,
+                               std::string &Error) {
+  StringRef File;
+  SmallVector<StringRef, 4> Callees;
+  unsigned Line = 0;
+  SmallVector<StringRef, 4> Fields;
+  Request.split(Fields, " ", -1, /*KeepEmpty=*/false);
+  for (StringRef Field : Fields) {
+    StringRef Key, Value;
+    std::tie(Key, Value) = Field.split('=');
+    if (Key == "file")
+      File = Value;
+    else if (Key == "callee")
+      Callees.push_back(Value);
+    else if (Key == "line" && !Value.getAsInteger(10, Line))
+      continue;
+    else {
+      Error = "invalid field '" + Field.str() + "'";
+      return false;
+    }
+  }
+  if (File.empty()) {
+    Error = "missing file=<path>";
+    return false;
+  }
+
+  Unit *U = getUnit(File, Error);
+  if (!U)
+    return false;
+
+  std::unique_ptr<OutputWriter> Writer = OutputWriter::create(Format, Out);
+  Writer->writeHeader();
+  CallFilter Filter(Line);
+  for (StringRef Callee : Callees)
+    Filter.addCalleeName(Callee);
+  SCCallBack Callback(Filter, [&](const CallRecord &Record) {
+    Writer->write(Record);
+  }, Options);
+  ASTContext &Context = U->getAST().getASTContext();
+  if (Filter.restrictsTraversal()) {
+    matchRestricted(Context, makeCallMatcher(Filter), Callback, Filter);
+  } else {
+    MatchFinder Finder;
+    addCallMatcher(Finder, Callback, Filter);
+    Finder.matchAST(Context);
+  }
+  return true;
+}
+
+void CallServer::serve(std::istream &In, raw_ostream &Out) {
+  std::string Line;
+  while (std::getline(In, Line)) {
+    StringRef Request = StringRef(Line).trim();
+    if (Request.empty())
+      continue;
+    if (Request == "quit")
+      break;
+
+    std::string Error;
+    if (handleRequest(Request, Out, Error))
+      Out << "%% ok\n";
+    else
+      Out << "%% error: " << Error << '\n';
+    Out.flush();
+  }
+}
+
+} // end namespace showcall
+} // end namespace clang
@@ -0,0 +1,76 @@
+//===-- Server.h - Answer queries on resident ASTs --------------*- C++ -*-===//
+//
+// A long running mode for editor integrations: the ASTs of the queried files
+// are built once and kept in memory, and only reparsed when one of the files
+// they were built from changes on disk.
+//
+// Requests are read one per line, as space separated key=value fields:
+//
+//   file=<path> [line=<N>] [callee=<name>]...
+//
+// where callee may be repeated.
+// The matching call sites are written in the selected output format, followed
+// by a line starting with "%%": either "%% ok" or "%% error: <message>".
+// A "quit" request, or the end of the input, stops the server.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SHOW_CALL_SERVER_H
+#define SHOW_CALL_SERVER_H
+
+#include "CallCollector.h"
+#include "OutputWriter.h"
+
+#include "llvm/ADT/StringRef.h"
+
+#include <iosfwd>
+#include <map>
+#include <memory>
+#include <string>
+
+namespace llvm {
+class raw_ostream;
+}
+
+namespace clang {
+namespace tooling {
+class CompilationDatabase;
+}
+
+namespace showcall {
+
+class CallServer {
+public:
+  CallServer(const tooling::CompilationDatabase &Compilations,
+             OutputFormat Format, const CallBackOptions &Options);
+  ~CallServer();
+
+  /// \brief Builds the AST of \p SourcePath now, rather than on its first
+  /// query.
+  bool preload(llvm::StringRef SourcePath);
+
+  /// \brief Answers the requests read from \p In until the end of the input
+  /// or a "quit" request.
+  void serve(std::istream &In, llvm::raw_ostream &Out);
+
+private:
+  class Unit;
+
+  /// \brief Returns the up to date AST of \p SourcePath, building it if
+  /// needed.
+  Unit *getUnit(llvm::StringRef SourcePath, std::string &Error);
+
+  bool handleRequest(llvm::StringRef Request, llvm::raw_ostream &Out,
+                     std::string &Error);
+
+  const tooling::CompilationDatabase &Compilations;
+  OutputFormat Format;
+  CallBackOptions Options;
+  /// Keyed by absolute path.
+  std::map<std::string, std::unique_ptr<Unit>> Units;
+};
+
+} // end namespace showcall
+} // end namespace clang
+
+#endif // SHOW_CALL_SERVER_H
@@ -0,0 +1,199 @@
+//===-- Shard.cpp - Split a run across machines ---------------------------===//
+//
+// A partial result file is made of tab separated lines:
+//
+//   show-call-partial 2 <tab> <K> <tab> <N> <tab> <number of paths>
+//   file <tab> <position> <tab> ok|failed <tab> <directory> <tab> <path>
+//   call <tab> <serialized CallRecord>
+//   replace <tab> <offset> <tab> <length> <tab> <file> <tab> <text>
+//   ...
+//
+// where the call and replace lines belong to the file line before them.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Shard.h"
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <numeric>
+
+using namespace clang::tooling;
+using namespace llvm;
+
+namespace clang {
+namespace showcall {
+
+namespace {
+const char PartialMagic[] = "show-call-partial 3";
+
+// Parses the file, call and replace lines of Text, numbered from
+// FirstLineNo, and appends the files to Files. Leaves Files as it was on
+// error.
+bool parseFileResults(StringRef Text, unsigned FirstLineNo, size_t NumPaths,
+                      std::vector<PartialFileResult> &Files,
+                      std::string &Error) {
+  size_t First = Files.size();
+  SmallVector<StringRef, 4> Fields;
+  StringRef Line, Rest = Text;
+  for (unsigned LineNo = FirstLineNo; !Rest.empty(); ++LineNo) {
+    std::tie(Line, Rest) = Rest.split('\n');
+    StringRef Tag;
+    std::tie(Tag, Line) = Line.split('\t');
+    bool Valid = false;
+    if (Tag == "file") {
+      Fields.clear();
+      Line.split(Fields, "\t");
+      PartialFileResult File;
+      if (Fields.size() == 4 && !Fields[0].getAsInteger(10, File.Position) &&
+          File.Position < NumPaths) {
+        File.Success = Fields[1] == "ok";
+        File.Directory = readField(Fields[2]);
+        File.SourcePath = readField(Fields[3]);
+        Files.push_back(std::move(File));
+        Valid = true;
+      }
+    } else if (Tag == "call" && Files.size() != First) {
+      CallRecord Record;
+      Valid = deserializeRecord(Line, Record);
+      if (Valid)
+        Files.back().Records.push_back(std::move(Record));
+    } else if (Tag == "replace" && Files.size() != First) {
+      Fields.clear();
+      Line.split(Fields, "\t");
+      unsigned Offset, Length;
+      if (Fields.size() == 4 && !Fields[0].getAsInteger(10, Offset) &&
+          !Fields[1].getAsInteger(10, Length)) {
+        Files.back().Replacements.push_back(Replacement(
+            readField(Fields[2]), Offset, Length, readField(Fields[3])));
+        Valid = true;
+      }
+    }
+    if (!Valid) {
+      Files.resize(First);
+      Error = "invalid line " + std::to_string(LineNo);
+      return false;
+    }
+  }
+  return true;
+}
+} // end anonymous namespace
+
+bool parseShardSpec(StringRef Spec, ShardSpec &Shard, std::string &Error) {
+  StringRef Index, Count;
+  std::tie(Index, Count) = Spec.split('/');
+  if (Index.getAsInteger(10, Shard.Index) ||
+      Count.getAsInteger(10, Shard.Count) || Shard.Count == 0 ||
+      Shard.Index == 0 || Shard.Index > Shard.Count) {
+    Error = "expected K/N with 1 <= K <= N, got '" + Spec.str() + "'";
+    return false;
+  }
+  return true;
+}
+
+std::vector<size_t> selectShard(ArrayRef<std::string> SourcePaths,
+                                const ShardSpec &Shard) {
+  std::vector<size_t> Order(SourcePaths.size());
+  std::iota(Order.begin(), Order.end(), 0);
+  std::stable_sort(Order.begin(), Order.end(), [&](size_t A, size_t B) {
+    return SourcePaths[A] < SourcePaths[B];
+  });
+
+  std::vector<size_t> Positions;
+  for (size_t I = Shard.Index - 1, E = Order.size(); I < E; I += Shard.Count)
+    Positions.push_back(Order[I]);
+  std::sort(Positions.begin(), Positions.end());
+  return Positions;
+}
+
+void writePartialHeader(raw_ostream &OS, const ShardSpec &Shard,
+                        size_t NumPaths) {
+  OS << PartialMagic << '\t' << Shard.Index << '\t' << Shard.Count << '\t'
+     << NumPaths << '\n';
+}
+
+void writePartialFileResult(raw_ostream &OS, const PartialFileResult &Result) {
+  OS << "file\t" << Result.Position << '\t'
+     << (Result.Success ? "ok" : "failed") << '\t';
+  writeField(OS, Result.Directory);
+  OS << '\t';
+  writeField(OS, Result.SourcePath);
+  OS << '\n';
+  for (const CallRecord &Record : Result.Records) {
+    OS << "call\t";
+    serializeRecord(Record, OS);
+  }
+  for (const Replacement &R : Result.Replacements) {
+    OS << "replace\t" << R.getOffset() << '\t' << R.getLength() << '\t';
+    writeField(OS, R.getFilePath());
+    OS << '\t';
+    writeField(OS, R.getReplacementText());
+    OS << '\n';
+  }
+}
+
+bool readPartialFileResults(StringRef Text, size_t NumPaths,
+                            std::vector<PartialFileResult> &Files,
+                            std::string &Error) {
+  return parseFileResults(Text, /*FirstLineNo=*/1, NumPaths, Files, Error);
+}
+
+bool PartialResults::read(StringRef FileName, std::string &Error) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> Buffer =
+      MemoryBuffer::getFile(FileName);
+  if (!Buffer) {
+    Error = Buffer.getError().message();
+    return false;
+  }
+
+  StringRef Line, Rest = (*Buffer)->getBuffer();
+  std::tie(Line, Rest) = Rest.split('\n');
+  SmallVector<StringRef, 4> Fields;
+  Line.split(Fields, "\t");
+  ShardSpec Shard;
+  size_t Paths;
+  if (Fields.size() != 4 || Fields[0] != PartialMagic ||
+      Fields[1].getAsInteger(10, Shard.Index) ||
+      Fields[2].getAsInteger(10, Shard.Count) ||
+      Fields[3].getAsInteger(10, Paths) || Shard.Index == 0 ||
+      Shard.Index > Shard.Count) {
+    Error = "not a show-call partial result file";
+    return false;
+  }
+  if (NumShards == 0) {
+    NumShards = Shard.Count;
+    NumPaths = Paths;
+    SeenShards.resize(NumShards);
+  } else if (Shard.Count != NumShards || Paths != NumPaths) {
+    Error = "partial result of another run";
+    return false;
+  }
+  if (SeenShards[Shard.Index - 1]) {
+    Error = "shard " + std::to_string(Shard.Index) + " given twice";
+    return false;
+  }
+  SeenShards[Shard.Index - 1] = true;
+
+  return parseFileResults(Rest, /*FirstLineNo=*/2, NumPaths, Files, Error);
+}
+
+bool PartialResults::finish(std::string &Error) {
+  for (unsigned I = 0; I != NumShards; ++I) {
+    if (!SeenShards[I]) {
+      Error = "missing the partial result of shard " + std::to_string(I + 1) +
+              "/" + std::to_string(NumShards);
+      return false;
+    }
+  }
+  std::stable_sort(Files.begin(), Files.end(),
+                   [](const PartialFileResult &A, const PartialFileResult &B) {
+    return A.Position < B.Position;
+  });
+  return true;
+}
+
+} // end namespace showcall
+} // end namespace clang
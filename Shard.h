@@ -0,0 +1,105 @@
+//===-- Shard.h - Split a run across machines -------------------*- C++ -*-===//
+//
+// With --shard K/N, a run only processes its share of the source files, and
+// writes a partial result file instead of the final output. --merge reads the
+// partial files of all N shards back, and prints what a single run over all
+// the files would have.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SHOW_CALL_SHARD_H
+#define SHOW_CALL_SHARD_H
+
+#include "CallRecord.h"
+
+#include "clang/Tooling/Refactoring.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <string>
+#include <vector>
+
+namespace llvm {
+class raw_ostream;
+}
+
+namespace clang {
+namespace showcall {
+
+/// \brief The K-th of N shards, K counting from 1.
+struct ShardSpec {
+  unsigned Index;
+  unsigned Count;
+
+  ShardSpec() : Index(1), Count(1) {}
+};
+
+/// \brief Parses a "K/N" shard specification.
+bool parseShardSpec(llvm::StringRef Spec, ShardSpec &Shard,
+                    std::string &Error);
+
+/// \brief Returns the positions in \p SourcePaths of the paths \p Shard
+/// processes, in increasing order.
+///
+/// Paths are dealt out round robin in sorted order, so that shards get the
+/// same number of files, and the split only depends on the set of paths:
+/// every shard must be given the same paths, but not in the same order.
+std::vector<size_t> selectShard(llvm::ArrayRef<std::string> SourcePaths,
+                                const ShardSpec &Shard);
+
+/// \brief What a shard found in one of its source files.
+struct PartialFileResult {
+  /// Position of the source path in the paths of the whole run, which is
+  /// where its results go in the merged output.
+  size_t Position;
+  std::string SourcePath;
+  /// Directory of the compile command. Record file names may be relative to
+  /// it, and --dedup-headers needs them absolute to compare files.
+  std::string Directory;
+  bool Success;
+  std::vector<CallRecord> Records;
+  std::vector<tooling::Replacement> Replacements;
+
+  PartialFileResult() : Position(0), Success(true) {}
+};
+
+/// \brief Writes the first line of a partial result file.
+void writePartialHeader(llvm::raw_ostream &OS, const ShardSpec &Shard,
+                        size_t NumPaths);
+
+/// \brief Appends the results of one source file to a partial result file.
+void writePartialFileResult(llvm::raw_ostream &OS,
+                            const PartialFileResult &Result);
+
+/// \brief Parses results written by writePartialFileResult, without the
+/// header line, and appends them to \p Files. Positions must be below
+/// \p NumPaths.
+bool readPartialFileResults(llvm::StringRef Text, size_t NumPaths,
+                            std::vector<PartialFileResult> &Files,
+                            std::string &Error);
+
+/// \brief The partial result files of a sharded run, read back by --merge.
+class PartialResults {
+public:
+  PartialResults() : NumShards(0), NumPaths(0) {}
+
+  /// \brief Reads the partial result file \p FileName.
+  bool read(llvm::StringRef FileName, std::string &Error);
+
+  /// \brief Checks that every shard was read exactly once, and sorts the
+  /// files back in the order of the whole run.
+  bool finish(std::string &Error);
+
+  const std::vector<PartialFileResult> &getFiles() const { return Files; }
+
+private:
+  unsigned NumShards;
+  size_t NumPaths;
+  std::vector<bool> SeenShards;
+  std::vector<PartialFileResult> Files;
+};
+
+} // end namespace showcall
+} // end namespace clang
+
+#endif // SHOW_CALL_SHARD_H
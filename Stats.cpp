@@ -0,0 +1,187 @@
+//===-- Stats.cpp - Timings and counters for --stats ----------------------===//
+
+#include "Stats.h"
+#include "OutputWriter.h"
+
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+
+#ifdef LLVM_ON_UNIX
+#include <sys/resource.h>
+#endif
+
+using namespace llvm;
+
+namespace clang {
+namespace showcall {
+
+namespace {
+const std::chrono::steady_clock::time_point ProcessStart =
+    std::chrono::steady_clock::now();
+
+// Small numbers are easier to read than thread ids in trace viewers.
+unsigned getThreadID() {
+  static std::atomic<unsigned> NextID(1);
+  static thread_local unsigned ID = NextID++;
+  return ID;
+}
+
+// In kilobytes, or 0 where unknown.
+uint64_t getPeakRSS() {
+#ifdef LLVM_ON_UNIX
+  struct rusage Usage;
+  if (getrusage(RUSAGE_SELF, &Usage) == 0)
+#ifdef __APPLE__
+    return Usage.ru_maxrss / 1024;
+#else
+    return Usage.ru_maxrss;
+#endif
+#endif
+  return 0;
+}
+
+const char *getPhaseName(StatsPhase Phase) {
+  switch (Phase) {
+  case SP_Total:      return "total";
+  case SP_Parse:      return "parse";
+  case SP_Match:      return "match";
+  case SP_SourceInfo: return "source locations";
+  case SP_Output:     return "output";
+  case SP_NumPhases:  break;
+  }
+  return "";
+}
+
+void printTime(raw_ostream &OS, const PhaseTime &Time) {
+  OS << format("%9.4fs wall %9.4fs cpu", Time.Wall, Time.CPU);
+}
+} // end anonymous namespace
+
+PhaseTime PhaseTime::now() {
+  PhaseTime Time;
+  Time.Wall = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                            ProcessStart).count();
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+  struct timespec TS;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &TS) == 0)
+    Time.CPU = TS.tv_sec + TS.tv_nsec / 1e9;
+#else
+  Time.CPU = double(std::clock()) / CLOCKS_PER_SEC;
+#endif
+  return Time;
+}
+
+TUStats::TUStats(StringRef FileName)
+    : FileName(FileName), FunctionCalls(0), MemberCalls(0), OperatorCalls(0),
+      ThreadID(getThreadID()) {}
+
+void TUStats::addMatch(const char *Kind) {
+  if (!std::strcmp(Kind, "Member"))
+    ++MemberCalls;
+  else if (!std::strcmp(Kind, "Operator"))
+    ++OperatorCalls;
+  else
+    ++FunctionCalls;
+}
+
+void TUStats::add(StatsPhase Phase, const PhaseTime &Start,
+                  const PhaseTime &End) {
+  Times[Phase] += End - Start;
+  // The fine grained phases would flood the trace.
+  if (Phase == SP_Total || Phase == SP_Parse || Phase == SP_Match) {
+    TraceEvent Event = { getPhaseName(Phase), Start.Wall,
+                         End.Wall - Start.Wall };
+    Events.push_back(Event);
+  }
+}
+
+void RunStats::addGlobal(StringRef Name, const PhaseTime &Time) {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  Globals.push_back(std::make_pair(Name.str(), Time));
+}
+
+void RunStats::add(TUStats Stats) {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  Files.push_back(std::move(Stats));
+}
+
+void RunStats::print(raw_ostream &OS) const {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  OS << "===-------------------------------------------------------------"
+        "------------===\n"
+     << "                          show-call statistics\n"
+     << "===-------------------------------------------------------------"
+        "------------===\n";
+
+  TUStats Sum("");
+  for (const TUStats &File : Files) {
+    OS << File.FileName << ":\n";
+    for (unsigned P = 0; P != SP_NumPhases; ++P) {
+      OS << format("  %-18s", getPhaseName(StatsPhase(P)));
+      printTime(OS, File.Times[P]);
+      OS << '\n';
+      Sum.Times[P] += File.Times[P];
+    }
+    OS << "  matches: " << File.FunctionCalls << " Function, "
+       << File.MemberCalls << " Member, " << File.OperatorCalls
+       << " Operator\n";
+    Sum.FunctionCalls += File.FunctionCalls;
+    Sum.MemberCalls += File.MemberCalls;
+    Sum.OperatorCalls += File.OperatorCalls;
+  }
+
+  OS << "All " << Files.size() << " files:\n";
+  for (const std::pair<std::string, PhaseTime> &Global : Globals) {
+    OS << format("  %-18s", Global.first.c_str());
+    printTime(OS, Global.second);
+    OS << '\n';
+  }
+  for (unsigned P = 0; P != SP_NumPhases; ++P) {
+    OS << format("  %-18s", getPhaseName(StatsPhase(P)));
+    printTime(OS, Sum.Times[P]);
+    OS << '\n';
+  }
+  OS << "  matches: " << Sum.FunctionCalls << " Function, "
+     << Sum.MemberCalls << " Member, " << Sum.OperatorCalls << " Operator\n";
+  if (uint64_t RSS = getPeakRSS())
+    OS << "  peak RSS: " << RSS / 1024 << " MB\n";
+}
+
+bool RunStats::writeTrace(StringRef FileName) const {
+  std::error_code EC;
+  raw_fd_ostream OS(FileName, EC, sys::fs::F_Text);
+  if (EC) {
+    llvm::errs() << "error: cannot write " << FileName << ": " << EC.message()
+                 << ".\n";
+    return false;
+  }
+
+  std::lock_guard<std::mutex> Lock(Mutex);
+  OS << "{\"traceEvents\":[";
+  bool First = true;
+  for (const TUStats &File : Files) {
+    for (const TUStats::TraceEvent &Event : File.Events) {
+      OS << (First ? "\n" : ",\n");
+      First = false;
+      OS << "{\"name\":\"" << Event.Name << "\",\"cat\":\"show-call\","
+         << "\"ph\":\"X\",\"pid\":1,\"tid\":" << File.ThreadID
+         << format(",\"ts\":%.0f,\"dur\":%.0f", Event.Start * 1e6,
+                   Event.Duration * 1e6)
+         << ",\"args\":{\"file\":";
+      writeJSONString(OS, File.FileName);
+      OS << "}}";
+    }
+  }
+  OS << "\n]}\n";
+  return true;
+}
+
+} // end namespace showcall
+} // end namespace clang
@@ -0,0 +1,140 @@
+//===-- Stats.h - Timings and counters for --stats --------------*- C++ -*-===//
+//
+// Where show-call spends its time: each translation unit gets a TUStats,
+// filled by the thread processing it, and handed over to RunStats once done.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SHOW_CALL_STATS_H
+#define SHOW_CALL_STATS_H
+
+#include "llvm/ADT/StringRef.h"
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace llvm {
+class raw_ostream;
+}
+
+namespace clang {
+namespace showcall {
+
+/// \brief Wall and CPU time, in seconds. The CPU time is the one of the
+/// calling thread where the platform allows, so that it stays meaningful
+/// with -j.
+struct PhaseTime {
+  double Wall;
+  double CPU;
+
+  PhaseTime() : Wall(0), CPU(0) {}
+  PhaseTime(double Wall, double CPU) : Wall(Wall), CPU(CPU) {}
+
+  /// \brief The current time. Wall times count from the start of the
+  /// process.
+  static PhaseTime now();
+
+  PhaseTime &operator+=(const PhaseTime &RHS) {
+    Wall += RHS.Wall;
+    CPU += RHS.CPU;
+    return *this;
+  }
+};
+
+inline PhaseTime operator-(const PhaseTime &LHS, const PhaseTime &RHS) {
+  return PhaseTime(LHS.Wall - RHS.Wall, LHS.CPU - RHS.CPU);
+}
+
+enum StatsPhase {
+  SP_Total,      ///< Everything done for the file.
+  SP_Parse,      ///< Parsing, from the creation of the AST consumer on.
+  SP_Match,      ///< Running the matchers, callbacks included.
+  SP_SourceInfo, ///< Source location lookups in the callback.
+  SP_Output,     ///< Writing records and building annotations.
+  SP_NumPhases
+};
+
+/// \brief What --stats collects on one translation unit.
+class TUStats {
+public:
+  explicit TUStats(llvm::StringRef FileName);
+
+  /// \brief Counts a match of the given kind (see CallRecord::Kind).
+  void addMatch(const char *Kind);
+
+  /// \brief Adds the time spent between \p Start and \p End to \p Phase.
+  void add(StatsPhase Phase, const PhaseTime &Start, const PhaseTime &End);
+
+private:
+  friend class RunStats;
+
+  struct TraceEvent {
+    const char *Name;
+    double Start;
+    double Duration;
+  };
+
+  std::string FileName;
+  PhaseTime Times[SP_NumPhases];
+  unsigned FunctionCalls;
+  unsigned MemberCalls;
+  unsigned OperatorCalls;
+  /// The spans of the coarse phases, for the --stats-trace output.
+  std::vector<TraceEvent> Events;
+  unsigned ThreadID;
+};
+
+/// \brief Adds the time spent in a scope to a phase of \p Stats, unless
+/// \p Stats is null.
+class StatsTimer {
+public:
+  StatsTimer(TUStats *Stats, StatsPhase Phase)
+      : Stats(Stats), Phase(Phase) {
+    if (Stats)
+      Start = PhaseTime::now();
+  }
+  ~StatsTimer() {
+    if (Stats)
+      Stats->add(Phase, Start, PhaseTime::now());
+  }
+
+private:
+  TUStats *Stats;
+  StatsPhase Phase;
+  PhaseTime Start;
+};
+
+/// \brief The statistics of a whole run.
+class RunStats {
+public:
+  RunStats() {}
+
+  /// \brief Time spent outside of any translation unit, e.g. loading the
+  /// compilation database.
+  void addGlobal(llvm::StringRef Name, const PhaseTime &Time);
+
+  /// \brief Takes the statistics of a translation unit, from any thread.
+  void add(TUStats Stats);
+
+  /// \brief Prints the per file and aggregated statistics, and the peak
+  /// memory use of the process.
+  void print(llvm::raw_ostream &OS) const;
+
+  /// \brief Writes the per file phases as a Chrome trace
+  /// (chrome://tracing, or https://ui.perfetto.dev).
+  bool writeTrace(llvm::StringRef FileName) const;
+
+private:
+  RunStats(const RunStats &) = delete;
+  void operator=(const RunStats &) = delete;
+
+  mutable std::mutex Mutex;
+  std::vector<TUStats> Files;
+  std::vector<std::pair<std::string, PhaseTime> > Globals;
+};
+
+} // end namespace showcall
+} // end namespace clang
+
+#endif // SHOW_CALL_STATS_H
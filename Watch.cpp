@@ -0,0 +1,294 @@
+//===-- Watch.cpp - Analyze the source files again as they change ---------===//
+
+#include "Watch.h"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <chrono>
+
+#ifdef __linux__
+#include <cerrno>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+using namespace llvm;
+
+namespace clang {
+namespace showcall {
+
+ErrorOr<std::unique_ptr<vfs::File>>
+RecordingFileSystem::openFileForRead(const Twine &Path) {
+  SmallString<256> FileName;
+  Path.toVector(FileName);
+  sys::fs::make_absolute(FileName);
+  ErrorOr<std::unique_ptr<vfs::File>> File = Base->openFileForRead(Path);
+  // The state of the file opened, rather than of the one found by a later
+  // stat(): a change in between must not go unnoticed.
+  FileState State;
+  if (File) {
+    ErrorOr<vfs::Status> Status = (*File)->status();
+    if (Status) {
+      sys::TimeValue Time = Status->getLastModificationTime();
+      State.Exists = true;
+      State.Size = Status->getSize();
+      State.ModTime =
+          uint64_t(Time.seconds()) * 1000000000 + Time.nanoseconds();
+    }
+  }
+  {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    Files.insert(std::make_pair(FileName.str(), State));
+  }
+  return File;
+}
+
+std::vector<std::string> RecordingFileSystem::getFiles() const {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  std::vector<std::string> Names;
+  for (const auto &File : Files)
+    Names.push_back(File.first);
+  return Names;
+}
+
+std::map<std::string, FileState> RecordingFileSystem::getStates() const {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  return Files;
+}
+
+FileWatcher::FileWatcher(bool ForcePolling, unsigned PollInterval)
+    : Polling(true), InotifyFD(-1), PollInterval(PollInterval),
+      Stopping(false) {
+#ifdef __linux__
+  if (!ForcePolling) {
+    InotifyFD = ::inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    if (InotifyFD >= 0)
+      Polling = false;
+    else
+      llvm::errs() << "warning: inotify is not available, polling the "
+                      "watched files instead.\n";
+  }
+#endif
+  Thread = std::thread(&FileWatcher::run, this);
+}
+
+FileWatcher::~FileWatcher() {
+  Stopping = true;
+  Thread.join();
+#ifdef __linux__
+  if (InotifyFD >= 0)
+    ::close(InotifyFD);
+#endif
+}
+
+FileState FileWatcher::getState(const std::string &File) {
+  FileState State;
+  sys::fs::file_status Status;
+  State.Exists = !sys::fs::status(File, Status) && sys::fs::exists(Status);
+  State.Size = State.Exists ? Status.getSize() : 0;
+  State.ModTime = 0;
+  if (State.Exists) {
+    sys::TimeValue Time = Status.getLastModificationTime();
+    State.ModTime =
+        uint64_t(Time.seconds()) * 1000000000 + Time.nanoseconds();
+  }
+  return State;
+}
+
+void FileWatcher::setFiles(ArrayRef<std::string> NewFiles,
+                           const std::map<std::string, FileState> &States) {
+  // The files are watched from their known states on, before being checked:
+  // a change from then on is seen either way.
+  std::set<std::string> Unknown;
+  {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    std::map<std::string, FileState> Known;
+    for (const std::string &File : NewFiles) {
+      std::map<std::string, FileState>::const_iterator State =
+          States.find(File);
+      std::map<std::string, FileState>::iterator Seen = Files.find(File);
+      if (State != States.end())
+        Known.insert(*State);
+      else if (Seen != Files.end())
+        Known.insert(*Seen);
+      else
+        Unknown.insert(File);
+    }
+    Files.swap(Known);
+    for (const std::string &File : NewFiles)
+      watchDirectory(sys::path::parent_path(File));
+  }
+
+  // Check the files outside of the lock, the checks of the thread go on.
+  std::vector<std::string> Names;
+  std::vector<FileState> Current;
+  for (const std::string &File : NewFiles) {
+    Names.push_back(File);
+    Current.push_back(getState(File));
+  }
+
+  std::lock_guard<std::mutex> Lock(Mutex);
+  for (const std::string &File : Unknown)
+    Files.insert(std::make_pair(File, FileState()));
+  for (size_t I = 0, E = Names.size(); I != E; ++I) {
+    std::map<std::string, FileState>::iterator File = Files.find(Names[I]);
+    bool New = Unknown.count(Names[I]);
+    if (New || File->second != Current[I]) {
+      if (!New)
+        addChange(Names[I]);
+      File->second = Current[I];
+    }
+  }
+}
+
+void FileWatcher::watchDirectory(const std::string &Directory) {
+  if (Polling || !WatchedDirectories.insert(Directory).second)
+    return;
+#ifdef __linux__
+  int WD = ::inotify_add_watch(InotifyFD, Directory.c_str(),
+                               IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM |
+                                   IN_CREATE | IN_DELETE);
+  if (WD >= 0) {
+    Directories[WD] = Directory;
+    return;
+  }
+  // Typically out of watches: the files are checked from now on, starting
+  // from the states setFiles read.
+  llvm::errs() << "warning: cannot watch " << Directory
+               << " with inotify, polling the watched files instead.\n";
+  Polling = true;
+#endif
+}
+
+void FileWatcher::addChange(const std::string &File) {
+  Changes.push_back(File);
+  Changed.notify_all();
+}
+
+size_t FileWatcher::getNumChanges() {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  return Changes.size();
+}
+
+size_t FileWatcher::waitForChanges(size_t First, unsigned Quiet) {
+  std::unique_lock<std::mutex> Lock(Mutex);
+  Changed.wait(Lock, [&] { return Changes.size() > First; });
+  // Saving several files, or switching branches, comes as a burst of
+  // changes: only return once it is over.
+  for (;;) {
+    size_t Seen = Changes.size();
+    if (!Changed.wait_for(Lock, std::chrono::milliseconds(Quiet),
+                          [&] { return Changes.size() != Seen; }))
+      return Changes.size();
+  }
+}
+
+std::vector<std::string> FileWatcher::getChanges(size_t First, size_t Last) {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  return std::vector<std::string>(Changes.begin() + First,
+                                  Changes.begin() + Last);
+}
+
+bool FileWatcher::isPolling() {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  return Polling;
+}
+
+void FileWatcher::checkFiles() {
+  std::vector<std::string> Names;
+  {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    for (const auto &File : Files)
+      Names.push_back(File.first);
+  }
+  std::vector<FileState> States;
+  for (const std::string &Name : Names)
+    States.push_back(getState(Name));
+
+  std::lock_guard<std::mutex> Lock(Mutex);
+  for (size_t I = 0, E = Names.size(); I != E; ++I) {
+    // setFiles may have replaced the files meanwhile.
+    std::map<std::string, FileState>::iterator File = Files.find(Names[I]);
+    if (File == Files.end())
+      continue;
+    FileState &Old = File->second;
+    const FileState &New = States[I];
+    if (Old != New) {
+      Old = New;
+      addChange(Names[I]);
+    }
+  }
+}
+
+void FileWatcher::readEvents() {
+#ifdef __linux__
+  pollfd FD = {InotifyFD, POLLIN, 0};
+  if (::poll(&FD, 1, 200) <= 0)
+    return;
+  alignas(inotify_event) char Buffer[1 << 16];
+  ssize_t N = ::read(InotifyFD, Buffer, sizeof(Buffer));
+  if (N <= 0)
+    return;
+
+  std::lock_guard<std::mutex> Lock(Mutex);
+  for (char *P = Buffer; P < Buffer + N;) {
+    const inotify_event *Event = reinterpret_cast<const inotify_event *>(P);
+    P += sizeof(inotify_event) + Event->len;
+    if (Event->mask & IN_Q_OVERFLOW) {
+      // Events were lost: anything may have changed.
+      for (const auto &File : Files)
+        addChange(File.first);
+      continue;
+    }
+    std::map<int, std::string>::iterator Directory =
+        Directories.find(Event->wd);
+    if (Directory == Directories.end() || Event->len == 0)
+      continue;
+    SmallString<256> File(Directory->second);
+    sys::path::append(File, Event->name);
+    if (Files.count(File.str()))
+      addChange(File.str());
+  }
+#endif
+}
+
+void FileWatcher::run() {
+  while (!Stopping) {
+    if (isPolling()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(PollInterval));
+      checkFiles();
+    } else {
+      readEvents();
+    }
+  }
+}
+
+std::vector<size_t> CallSiteHistory::update(StringRef SourcePath,
+                                            ArrayRef<CallRecord> Records) {
+  std::map<std::string, std::string> &Old = Callees[SourcePath.str()];
+  std::map<std::string, std::string> New;
+  // The number of call sites alike so far.
+  std::map<std::string, unsigned> Ranks;
+  std::vector<size_t> Changed;
+  for (size_t I = 0, E = Records.size(); I != E; ++I) {
+    const CallRecord &Record = Records[I];
+    std::string Key = Record.FileName + '\0' + Record.CallerName + '\0' +
+                      Record.CallText + '\0';
+    Key += std::to_string(Ranks[Key]++);
+
+    std::string Callee = Record.CalleeName + '\0' + Record.CalleeType;
+    std::map<std::string, std::string>::const_iterator Known = Old.find(Key);
+    if (Known == Old.end() || Known->second != Callee)
+      Changed.push_back(I);
+    New.insert(std::make_pair(std::move(Key), std::move(Callee)));
+  }
+  Old.swap(New);
+  return Changed;
+}
+
+} // end namespace showcall
+} // end namespace clang
@@ -0,0 +1,165 @@
+//===-- Watch.h - Analyze the source files again as they change -*- C++ -*-===//
+//
+// The --watch mode: after a first pass over the source files, show-call
+// waits for changes to them or to the files they include, parses again the
+// translation units affected, and prints the call sites whose callee changed.
+// The pieces are here: a file system recording what each translation unit
+// reads, a watcher of those files, and the history of the callees.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SHOW_CALL_WATCH_H
+#define SHOW_CALL_WATCH_H
+
+#include "CallRecord.h"
+
+#include "clang/Basic/VirtualFileSystem.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/IntrusiveRefCntPtr.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace clang {
+namespace showcall {
+
+/// \brief What tells that a file changed.
+struct FileState {
+  bool Exists;
+  uint64_t Size;
+  uint64_t ModTime;
+
+  FileState() : Exists(false), Size(0), ModTime(0) {}
+
+  bool operator==(const FileState &Other) const {
+    return Exists == Other.Exists && Size == Other.Size &&
+           ModTime == Other.ModTime;
+  }
+  bool operator!=(const FileState &Other) const { return !(*this == Other); }
+};
+
+/// \brief Passes everything on to \p Base, remembering the files opened.
+///
+/// Each translation unit is given its own, to learn which files to watch for
+/// it. Relative paths are made absolute against the current directory.
+class RecordingFileSystem : public vfs::FileSystem {
+public:
+  explicit RecordingFileSystem(IntrusiveRefCntPtr<vfs::FileSystem> Base)
+      : Base(Base) {}
+
+  llvm::ErrorOr<vfs::Status> status(const llvm::Twine &Path) override {
+    return Base->status(Path);
+  }
+  llvm::ErrorOr<std::unique_ptr<vfs::File>>
+  openFileForRead(const llvm::Twine &Path) override;
+  vfs::directory_iterator dir_begin(const llvm::Twine &Dir,
+                                    std::error_code &EC) override {
+    return Base->dir_begin(Dir, EC);
+  }
+
+  /// \brief The absolute paths of the files opened so far, sorted.
+  std::vector<std::string> getFiles() const;
+
+  /// \brief The state of each file opened so far, by absolute path, as of
+  /// the first time it was opened: that of the contents read, when \p Base
+  /// caches them.
+  std::map<std::string, FileState> getStates() const;
+
+private:
+  IntrusiveRefCntPtr<vfs::FileSystem> Base;
+  mutable std::mutex Mutex;
+  std::map<std::string, FileState> Files;
+};
+
+/// \brief Watches a set of files from a thread of its own, and numbers
+/// their changes from 0 in the order they are seen.
+///
+/// On Linux, the directories of the files are watched with inotify, which
+/// sees the editors replacing a file by renaming another over it. Elsewhere,
+/// when \p ForcePolling, or when the system runs out of inotify watches, the
+/// files are checked with stat() every \p PollInterval milliseconds instead.
+class FileWatcher {
+public:
+  FileWatcher(bool ForcePolling, unsigned PollInterval);
+  ~FileWatcher();
+
+  /// \brief Watches \p Files, absolute paths, from now on, instead of the
+  /// previous ones.
+  ///
+  /// A file counts as changed if it is no longer as in \p States, e.g. as
+  /// it was read by the translation units including it, or else as last
+  /// seen by the watcher: the changes made before the call are not missed.
+  void setFiles(llvm::ArrayRef<std::string> Files,
+                const std::map<std::string, FileState> &States);
+
+  /// \brief Returns the number of changes seen so far.
+  size_t getNumChanges();
+
+  /// \brief Waits for a change numbered \p First or more, then until none
+  /// came for \p Quiet milliseconds, and returns the number of changes.
+  size_t waitForChanges(size_t First, unsigned Quiet);
+
+  /// \brief Returns the files of the changes numbered from \p First to
+  /// \p Last, excluded.
+  std::vector<std::string> getChanges(size_t First, size_t Last);
+
+  bool isPolling();
+
+private:
+  FileWatcher(const FileWatcher &) = delete;
+  void operator=(const FileWatcher &) = delete;
+
+  static FileState getState(const std::string &File);
+  void addChange(const std::string &File);
+  void watchDirectory(const std::string &Directory);
+  void checkFiles();
+  void readEvents();
+  void run();
+
+  std::mutex Mutex;
+  std::condition_variable Changed;
+  /// All guarded by Mutex.
+  std::map<std::string, FileState> Files;
+  std::vector<std::string> Changes;
+  std::set<std::string> WatchedDirectories;
+  std::map<int, std::string> Directories;
+  bool Polling;
+
+  int InotifyFD;
+  unsigned PollInterval;
+  std::atomic<bool> Stopping;
+  std::thread Thread;
+};
+
+/// \brief The callee of each call site of each source path, as of the last
+/// time it was parsed.
+///
+/// Call sites are told apart by their file, caller and text, and by their
+/// rank among the calls alike, rather than by their position: an edit above
+/// a call does not make it a different one. Callees are compared by name and
+/// type, for the same reason.
+class CallSiteHistory {
+public:
+  /// \brief Replaces the call sites of \p SourcePath by \p Records, and
+  /// returns the positions in \p Records of the call sites which are new,
+  /// or whose callee changed.
+  std::vector<size_t> update(llvm::StringRef SourcePath,
+                             llvm::ArrayRef<CallRecord> Records);
+
+private:
+  /// Callee by call site key, per source path.
+  std::map<std::string, std::map<std::string, std::string>> Callees;
+};
+
+} // end namespace showcall
+} // end namespace clang
+
+#endif // SHOW_CALL_WATCH_H
@@ -0,0 +1,370 @@
+//===-- WorkerPool.cpp - Run translation units in child processes ---------===//
+//
+// The parent sends each worker the index of its next path on a pipe, one per
+// line, and the worker answers on another pipe with the size of its result
+// in decimal, a newline, and the result. The parent polls the answer pipes of
+// the busy workers: an end of file means the worker died, and a worker past
+// its deadline is killed. Either way it is waited for, and replaced by a
+// fresh fork when there is work left.
+//
+//===----------------------------------------------------------------------===//
+
+#include "WorkerPool.h"
+
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <numeric>
+#include <thread>
+
+#ifdef LLVM_ON_UNIX
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace llvm;
+
+namespace clang {
+namespace showcall {
+
+#ifdef LLVM_ON_UNIX
+namespace {
+// How many results runInWorkerProcesses holds back, waiting for the paths
+// before them: at least this many paths (more with many workers), and this
+// many bytes.
+const size_t MinHeldBackPaths = 16;
+const size_t MaxHeldBackBytes = 64 << 20;
+
+typedef std::chrono::steady_clock Clock;
+
+struct Worker {
+  pid_t Pid;
+  int ToChild;
+  int FromChild;
+  bool Busy;
+  /// The path in progress, when busy.
+  size_t Index;
+  Clock::time_point Start;
+  /// What came from the worker so far for that path.
+  std::string Input;
+
+  Worker() : Pid(-1), ToChild(-1), FromChild(-1), Busy(false), Index(0) {}
+};
+
+bool writeAll(int FD, StringRef Data) {
+  while (!Data.empty()) {
+    ssize_t N = ::write(FD, Data.data(), Data.size());
+    if (N < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    Data = Data.drop_front(N);
+  }
+  return true;
+}
+
+// The body of a worker process, which never returns: exiting through exit()
+// would flush the output streams and run the destructors of the parent.
+LLVM_ATTRIBUTE_NORETURN void runWorker(int In, int Out,
+                                       const WorkerProcessor &Process) {
+  std::string Line;
+  for (;;) {
+    char C;
+    ssize_t N = ::read(In, &C, 1);
+    if (N < 0 && errno == EINTR)
+      continue;
+    if (N <= 0)
+      _exit(0);
+    if (C != '\n') {
+      Line += C;
+      continue;
+    }
+
+    size_t Index;
+    if (StringRef(Line).getAsInteger(10, Index))
+      _exit(1);
+    Line.clear();
+    std::string Result;
+    {
+      raw_string_ostream OS(Result);
+      Process(Index, OS);
+    }
+    if (!writeAll(Out, std::to_string(Result.size()) + "\n") ||
+        !writeAll(Out, Result))
+      _exit(1);
+  }
+}
+
+void closePipes(Worker &W) {
+  ::close(W.ToChild);
+  ::close(W.FromChild);
+  W.ToChild = W.FromChild = -1;
+}
+
+// Forks W, which must not be running.
+bool startWorker(Worker &W, std::vector<Worker> &Workers,
+                 const WorkerProcessor &Process) {
+  int ToChild[2], FromChild[2];
+  if (::pipe(ToChild))
+    return false;
+  if (::pipe(FromChild)) {
+    ::close(ToChild[0]);
+    ::close(ToChild[1]);
+    return false;
+  }
+
+  pid_t Pid = ::fork();
+  if (Pid < 0) {
+    for (int FD : {ToChild[0], ToChild[1], FromChild[0], FromChild[1]})
+      ::close(FD);
+    return false;
+  }
+  if (Pid == 0) {
+    // The other workers only see the end of their input once every copy of
+    // its write end is closed.
+    for (Worker &Other : Workers)
+      if (Other.Pid > 0)
+        closePipes(Other);
+    ::close(ToChild[1]);
+    ::close(FromChild[0]);
+    runWorker(ToChild[0], FromChild[1], Process);
+  }
+
+  ::close(ToChild[0]);
+  ::close(FromChild[1]);
+  W.Pid = Pid;
+  W.ToChild = ToChild[1];
+  W.FromChild = FromChild[0];
+  W.Busy = false;
+  W.Input.clear();
+  return true;
+}
+
+// Waits for W to exit, killing it first if Kill, and returns its status.
+int stopWorker(Worker &W, bool Kill) {
+  if (Kill)
+    ::kill(W.Pid, SIGKILL);
+  closePipes(W);
+  int Status = 0;
+  while (::waitpid(W.Pid, &Status, 0) < 0 && errno == EINTR)
+    ;
+  W.Pid = -1;
+  return Status;
+}
+
+std::string describeExit(int Status) {
+  if (WIFSIGNALED(Status))
+    return std::string("crashed (") + ::strsignal(WTERMSIG(Status)) + ")";
+  return "exited with status " + std::to_string(WEXITSTATUS(Status));
+}
+} // end anonymous namespace
+
+std::vector<size_t>
+runInWorkerProcesses(ArrayRef<std::string> SourcePaths,
+                     const WorkerPoolOptions &Options,
+                     const WorkerProcessor &Process,
+                     const WorkerResultConsumer &Consume,
+                     ArrayRef<double> Costs, std::vector<double> *Times) {
+  size_t NumPaths = SourcePaths.size();
+  if (Times)
+    Times->assign(NumPaths, 0.0);
+  std::vector<size_t> Failed;
+  if (NumPaths == 0)
+    return Failed;
+
+  unsigned NumWorkers = Options.Workers;
+  if (NumWorkers == 0)
+    NumWorkers = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<Worker> Workers(std::min<size_t>(NumWorkers, NumPaths));
+
+  std::deque<size_t> Pending(NumPaths);
+  std::iota(Pending.begin(), Pending.end(), 0);
+  if (Costs.size() == NumPaths)
+    std::stable_sort(Pending.begin(), Pending.end(), [&](size_t A, size_t B) {
+      return Costs[A] > Costs[B];
+    });
+
+  enum PathState { PS_Pending, PS_Done, PS_Failed };
+  std::vector<PathState> States(NumPaths, PS_Pending);
+  std::vector<std::string> Results(NumPaths);
+  std::vector<unsigned> Attempts(NumPaths);
+  size_t NextConsumed = 0;
+  // The results waiting for the paths before them, and their size.
+  size_t HeldBack = 0;
+  size_t HeldBackBytes = 0;
+  size_t MaxHeldBack = std::max<size_t>(MinHeldBackPaths, 4 * Workers.size());
+
+  // A worker dying while we write to it must not take us down with it.
+  struct sigaction IgnorePipe, OldPipe;
+  std::memset(&IgnorePipe, 0, sizeof(IgnorePipe));
+  IgnorePipe.sa_handler = SIG_IGN;
+  ::sigaction(SIGPIPE, &IgnorePipe, &OldPipe);
+
+  auto Fail = [&](Worker &W, const std::string &Reason) {
+    size_t Index = W.Index;
+    W.Busy = false;
+    bool Retry = ++Attempts[Index] <= Options.Retries;
+    llvm::errs() << "warning: the worker processing " << SourcePaths[Index]
+                 << " " << Reason
+                 << (Retry ? ", retrying.\n" : ", giving up on the file.\n");
+    if (Retry) {
+      Pending.push_front(Index);
+    } else {
+      States[Index] = PS_Failed;
+      Failed.push_back(Index);
+    }
+  };
+
+  while (NextConsumed != NumPaths) {
+    // Keep every worker busy, starting new ones to replace the dead.
+    for (Worker &W : Workers) {
+      if (W.Busy || Pending.empty())
+        continue;
+      if (W.Pid < 0 && !startWorker(W, Workers, Process)) {
+        std::string Reason = std::strerror(errno);
+        if (std::none_of(Workers.begin(), Workers.end(),
+                         [](const Worker &Other) { return Other.Pid > 0; }))
+          llvm::report_fatal_error("Cannot start a worker process: " + Reason);
+        continue;
+      }
+      // With too many results held back, only the path they wait for may
+      // start.
+      std::deque<size_t>::iterator Next = Pending.begin();
+      if (HeldBack >= MaxHeldBack || HeldBackBytes >= MaxHeldBackBytes) {
+        Next = std::find(Pending.begin(), Pending.end(), NextConsumed);
+        if (Next == Pending.end())
+          continue;
+      }
+      size_t Index = *Next;
+      Pending.erase(Next);
+      if (!writeAll(W.ToChild, std::to_string(Index) + "\n")) {
+        // Died while idle: the path is not to blame.
+        stopWorker(W, /*Kill=*/false);
+        Pending.push_front(Index);
+        continue;
+      }
+      W.Busy = true;
+      W.Index = Index;
+      W.Start = Clock::now();
+      W.Input.clear();
+    }
+
+    std::vector<pollfd> FDs;
+    std::vector<Worker *> Polled;
+    int Wait = -1;
+    Clock::time_point Now = Clock::now();
+    for (Worker &W : Workers) {
+      if (!W.Busy)
+        continue;
+      pollfd FD = {W.FromChild, POLLIN, 0};
+      FDs.push_back(FD);
+      Polled.push_back(&W);
+      if (Options.Timeout) {
+        Clock::duration Left =
+            W.Start + std::chrono::seconds(Options.Timeout) - Now;
+        int Milliseconds = std::max<int>(
+            0, std::chrono::duration_cast<std::chrono::milliseconds>(Left)
+                       .count() + 1);
+        Wait = Wait < 0 ? Milliseconds : std::min(Wait, Milliseconds);
+      }
+    }
+    if (FDs.empty())
+      llvm::report_fatal_error("No worker process left to run.");
+
+    if (::poll(FDs.data(), FDs.size(), Wait) < 0) {
+      if (errno == EINTR)
+        continue;
+      llvm::report_fatal_error(std::string("Cannot wait for the workers: ") +
+                               std::strerror(errno));
+    }
+
+    Now = Clock::now();
+    for (size_t I = 0, E = FDs.size(); I != E; ++I) {
+      Worker &W = *Polled[I];
+      if (!FDs[I].revents) {
+        if (Options.Timeout &&
+            Now - W.Start >= std::chrono::seconds(Options.Timeout)) {
+          stopWorker(W, /*Kill=*/true);
+          Fail(W, "timed out after " + std::to_string(Options.Timeout) +
+                      " seconds");
+        }
+        continue;
+      }
+
+      char Buffer[1 << 16];
+      ssize_t N = ::read(W.FromChild, Buffer, sizeof(Buffer));
+      if (N < 0 && errno == EINTR)
+        continue;
+      if (N <= 0) {
+        Fail(W, describeExit(stopWorker(W, /*Kill=*/true)));
+        continue;
+      }
+      W.Input.append(Buffer, N);
+
+      size_t EOL = W.Input.find('\n');
+      if (EOL == std::string::npos)
+        continue;
+      size_t Size;
+      if (StringRef(W.Input).substr(0, EOL).getAsInteger(10, Size)) {
+        stopWorker(W, /*Kill=*/true);
+        Fail(W, "sent an invalid result");
+        continue;
+      }
+      if (W.Input.size() - EOL - 1 < Size)
+        continue;
+      Results[W.Index] = W.Input.substr(EOL + 1, Size);
+      States[W.Index] = PS_Done;
+      ++HeldBack;
+      HeldBackBytes += Size;
+      if (Times)
+        (*Times)[W.Index] =
+            std::chrono::duration<double>(Now - W.Start).count();
+      W.Busy = false;
+      W.Input.clear();
+    }
+
+    // Hand the results over in path order, as soon as all the paths before
+    // them are settled.
+    for (; NextConsumed != NumPaths && States[NextConsumed] != PS_Pending;
+         ++NextConsumed) {
+      if (States[NextConsumed] == PS_Done) {
+        Consume(NextConsumed, Results[NextConsumed]);
+        --HeldBack;
+        HeldBackBytes -= Results[NextConsumed].size();
+      }
+      std::string().swap(Results[NextConsumed]);
+    }
+  }
+
+  // Workers exit at the end of their input.
+  for (Worker &W : Workers)
+    if (W.Pid > 0)
+      stopWorker(W, /*Kill=*/false);
+  ::sigaction(SIGPIPE, &OldPipe, nullptr);
+
+  std::sort(Failed.begin(), Failed.end());
+  return Failed;
+}
+#else
+std::vector<size_t>
+runInWorkerProcesses(ArrayRef<std::string> SourcePaths,
+                     const WorkerPoolOptions &Options,
+                     const WorkerProcessor &Process,
+                     const WorkerResultConsumer &Consume,
+                     ArrayRef<double> Costs, std::vector<double> *Times) {
+  llvm::report_fatal_error("Worker processes are only supported on Unix.");
+}
+#endif
+
+} // end namespace showcall
+} // end namespace clang
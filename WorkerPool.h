@@ -0,0 +1,76 @@
+//===-- WorkerPool.h - Run translation units in child processes -*- C++ -*-===//
+//
+// A crash in the parser or in show-call itself, on a single translation unit,
+// takes down the whole run and every result found so far. With --isolate the
+// source paths are instead processed by a pool of forked worker processes:
+// a worker that crashes or runs out of time is replaced, the file it was on
+// is retried or given up, and the run goes on with the others.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SHOW_CALL_WORKERPOOL_H
+#define SHOW_CALL_WORKERPOOL_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace llvm {
+class raw_ostream;
+}
+
+namespace clang {
+namespace showcall {
+
+/// \brief Processes the path at \p Index in a worker process, writing what
+/// the parent needs to know to \p OS.
+typedef std::function<void(size_t Index, llvm::raw_ostream &OS)>
+    WorkerProcessor;
+
+/// \brief Receives, in the parent, what the worker wrote for the path at
+/// \p Index.
+typedef std::function<void(size_t Index, llvm::StringRef Result)>
+    WorkerResultConsumer;
+
+struct WorkerPoolOptions {
+  /// Number of worker processes (0 means one per hardware thread).
+  unsigned Workers;
+  /// A path still in progress after this many seconds has its worker
+  /// killed (0 means no limit).
+  unsigned Timeout;
+  /// How many more times a path whose worker crashed or timed out is tried,
+  /// each time in a fresh worker.
+  unsigned Retries;
+
+  WorkerPoolOptions() : Workers(1), Timeout(0), Retries(1) {}
+};
+
+/// \brief Calls \p Process on each of \p SourcePaths in forked worker
+/// processes, and \p Consume in this process with the result of each path
+/// that completed, in index order.
+///
+/// Each worker processes paths one after the other until there are none
+/// left. Workers are forked, and replaced, while the run goes on: no other
+/// thread of this process may be running meanwhile. Paths are started
+/// biggest first when \p Costs, with one estimate per path, is given. The
+/// wall time spent on each completed path is stored in \p Times, if not
+/// null. As in runOnSourcePaths, once too many results wait for the paths
+/// before them, only the first path not settled yet may start.
+///
+/// \returns the indices of the paths which never completed, in increasing
+/// order.
+std::vector<size_t>
+runInWorkerProcesses(llvm::ArrayRef<std::string> SourcePaths,
+                     const WorkerPoolOptions &Options,
+                     const WorkerProcessor &Process,
+                     const WorkerResultConsumer &Consume,
+                     llvm::ArrayRef<double> Costs = llvm::None,
+                     std::vector<double> *Times = nullptr);
+
+} // end namespace showcall
+} // end namespace clang
+
+#endif // SHOW_CALL_WORKERPOOL_H
@@ -0,0 +1,272 @@
+#!/usr/bin/env python
+#===- bench/run-benchmarks.py - show-call benchmarks ----------*- python -*-===#
+#
+# Generates synthetic translation units of a configurable size, runs
+# show-call over them in each of its main modes, and records the throughput
+# (call sites per second) and the peak memory of every run in a JSON file.
+# Given the results of an earlier version with --baseline, reports the runs
+# which got slower or bigger.
+#
+#===------------------------------------------------------------------------===#
+
+from __future__ import print_function
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import time
+
+
+def write_namespaces(path, namespaces, functions):
+    """N namespaces, each with a class and free functions, all called from
+    main. Returns the line of the first call, for --call-at-line."""
+    lines = []
+    for n in range(namespaces):
+        lines.append('namespace N%d {' % n)
+        lines.append('  struct C { void m(int) {} int k(double) { return 0; } };')
+        for f in range(functions):
+            lines.append('  int f%d(int x) { return x + %d; }' % (f, f))
+        lines.append('}')
+    lines.append('int main() {')
+    lines.append('  int r = 0;')
+    first_call = None
+    for n in range(namespaces):
+        lines.append('  N%d::C c%d;' % (n, n))
+        first_call = first_call or len(lines) + 1
+        lines.append('  c%d.m(r); r += c%d.k(1.0);' % (n, n))
+        for f in range(functions):
+            lines.append('  r += N%d::f%d(r);' % (n, f))
+    lines.append('  return r;')
+    lines.append('}')
+    with open(path, 'w') as f:
+        f.write('\n'.join(lines) + '\n')
+    return first_call
+
+
+def write_overloads(path, sets, size):
+    """Overload sets of the given size, each member called once. Returns the
+    line of the first call."""
+    types = ['char', 'short', 'int', 'long', 'float', 'double', 'bool',
+             'unsigned', 'long long', 'long double']
+    lines = ['struct T%d {};' % t for t in range(size)]
+    for s in range(sets):
+        for k in range(size):
+            param = types[k] if k < len(types) else 'T%d' % k
+            lines.append('int o%d(%s) { return %d; }' % (s, param, k))
+    lines.append('int main() {')
+    lines.append('  int r = 0;')
+    first_call = len(lines) + 1
+    for s in range(sets):
+        for k in range(size):
+            arg = '(%s)1' % types[k] if k < len(types) else 'T%d()' % k
+            lines.append('  r += o%d(%s);' % (s, arg))
+    lines.append('  return r;')
+    lines.append('}')
+    with open(path, 'w') as f:
+        f.write('\n'.join(lines) + '\n')
+    return first_call
+
+
+def write_templates(path, depth, width):
+    """Recursive templates, instantiated depth levels deep, width times.
+    Returns the line of the call in the template."""
+    lines = [
+        'template <int N, typename T> struct R {',
+        '  static T get(T x) { return R<N - 1, T>::get(x) + step(x); }',
+        '  static T step(T x) { return x; }',
+        '};',
+        'template <typename T> struct R<0, T> {',
+        '  static T get(T x) { return x; }',
+        '};',
+    ]
+    lines += ['struct W%d { int v; W%d(int v = 0) : v(v) {} '
+              'W%d operator+(W%d o) const { return W%d(v + o.v); } };'
+              % ((w,) * 5) for w in range(width)]
+    lines.append('int main() {')
+    lines.append('  int r = 0;')
+    for w in range(width):
+        lines.append('  r += R<%d, W%d>::get(W%d(1)).v;' % (depth, w, w))
+    lines.append('  return r;')
+    lines.append('}')
+    with open(path, 'w') as f:
+        f.write('\n'.join(lines) + '\n')
+    return 2
+
+
+def write_stl(path, functions):
+    """Heavy standard library includes, and functions using them. Returns
+    the line of the first sort call."""
+    headers = ['algorithm', 'functional', 'iostream', 'map', 'memory',
+               'set', 'sstream', 'string', 'unordered_map', 'vector']
+    lines = ['#include <%s>' % h for h in headers]
+    for f in range(functions):
+        lines += [
+            'int s%d(const std::vector<int> &v) {' % f,
+            '  std::map<int, std::string> m;',
+            '  std::unordered_map<std::string, int> u;',
+            '  for (int x : v) { m[x] = std::to_string(x); u[m[x]] = x; }',
+            '  std::vector<int> w(v.begin(), v.end());',
+            '  std::sort(w.begin(), w.end());',
+            '  std::ostringstream os; os << w.size() << m.size();',
+            '  return (int)u.size() + (int)os.str().size();',
+            '}',
+        ]
+    lines.append('int main() {')
+    lines.append('  std::vector<int> v(10, 1); int r = 0;')
+    for f in range(functions):
+        lines.append('  r += s%d(v);' % f)
+    lines.append('  std::cout << r << std::endl;')
+    lines.append('  return 0;')
+    lines.append('}')
+    with open(path, 'w') as f:
+        f.write('\n'.join(lines) + '\n')
+    return len(headers) + 6
+
+
+def generate(work_dir, scale):
+    """Writes the inputs and their compile_commands.json. Returns a list of
+    (name, source path, extra per input data)."""
+    src_dir = os.path.join(work_dir, 'src')
+    if not os.path.isdir(src_dir):
+        os.makedirs(src_dir)
+    inputs = []
+
+    path = os.path.join(src_dir, 'namespaces.cpp')
+    line = write_namespaces(path, 10 * scale, 20)
+    inputs.append(('namespaces', path, {'line': line, 'callee': 'f0'}))
+
+    path = os.path.join(src_dir, 'overloads.cpp')
+    line = write_overloads(path, 10 * scale, 16)
+    inputs.append(('overloads', path, {'line': line, 'callee': 'o0'}))
+
+    path = os.path.join(src_dir, 'templates.cpp')
+    line = write_templates(path, min(50 * scale, 900), 10)
+    inputs.append(('templates', path, {'line': line, 'callee': 'step'}))
+
+    path = os.path.join(src_dir, 'stl.cpp')
+    line = write_stl(path, 5 * scale)
+    inputs.append(('stl', path, {'line': line, 'callee': 'sort'}))
+
+    commands = [{
+        'directory': src_dir,
+        'command': 'clang++ -std=c++11 -ftemplate-depth=1024 -c %s' % path,
+        'file': path,
+    } for (_, path, _) in inputs]
+    with open(os.path.join(src_dir, 'compile_commands.json'), 'w') as f:
+        json.dump(commands, f, indent=2)
+    return src_dir, inputs
+
+
+def modes(work_dir, data):
+    """The show-call options of each benchmarked mode."""
+    return [
+        ('plain', []),
+        ('callee-name', ['--callee-name=%s' % data['callee']]),
+        ('call-at-line', ['--call-at-line=%d' % data['line']]),
+        ('annotate', ['--annotate',
+                      '--annotate-dir=%s' % os.path.join(work_dir, 'annotated')]),
+        ('ast-dumps', ['--show-call-ast', '--show-callee-ast']),
+    ]
+
+
+def run_one(show_call, src_dir, path, options, output):
+    """Runs show-call once. Returns (seconds, peak RSS in KB, call sites)."""
+    args = [show_call, '--format=jsonl', '-o', output] + options + \
+        [src_dir, path]
+    with open(os.devnull, 'w') as devnull:
+        start = time.time()
+        proc = subprocess.Popen(args, stderr=devnull)
+        _, status, usage = os.wait4(proc.pid, 0)
+        seconds = time.time() - start
+    if status != 0:
+        raise RuntimeError('failed: %s' % ' '.join(args))
+    # ru_maxrss is in KB on Linux, but in bytes on Darwin.
+    rss = usage.ru_maxrss
+    if sys.platform == 'darwin':
+        rss //= 1024
+    with open(output) as f:
+        calls = sum(1 for _ in f)
+    return seconds, rss, calls
+
+
+def compare(results, baseline_file, tolerance):
+    """Prints the runs slower or bigger than in the baseline by more than
+    tolerance (a ratio). Returns the number of regressions."""
+    with open(baseline_file) as f:
+        baseline = json.load(f)
+    old = dict(((r['input'], r['mode']), r) for r in baseline['results'])
+    regressions = 0
+    for r in results:
+        b = old.get((r['input'], r['mode']))
+        if not b:
+            continue
+        for key, better in (('call_sites_per_sec', max),
+                            ('peak_rss_kb', min)):
+            if not b[key] or not r[key]:
+                continue
+            ratio = float(r[key]) / b[key]
+            worse = ratio < 1 - tolerance if better is max else \
+                ratio > 1 + tolerance
+            if worse:
+                regressions += 1
+                print('regression: %s %s: %s %s -> %s' %
+                      (r['input'], r['mode'], key, b[key], r[key]))
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Benchmark show-call on generated translation units.')
+    parser.add_argument('--show-call', default='show-call',
+                        help='the show-call binary to benchmark')
+    parser.add_argument('--work-dir', default='show-call-bench',
+                        help='where the inputs and outputs are written')
+    parser.add_argument('--scale', type=int, default=10,
+                        help='size factor of the generated inputs')
+    parser.add_argument('--repeat', type=int, default=3,
+                        help='runs per benchmark, the fastest is kept')
+    parser.add_argument('--output', default='show-call-bench.json',
+                        help='the JSON file receiving the results')
+    parser.add_argument('--baseline',
+                        help='results of an earlier version to compare with')
+    parser.add_argument('--tolerance', type=float, default=0.1,
+                        help='relative change reported as a regression')
+    args = parser.parse_args()
+
+    work_dir = os.path.abspath(args.work_dir)
+    src_dir, inputs = generate(work_dir, args.scale)
+    results = []
+    for name, path, data in inputs:
+        for mode, options in modes(work_dir, data):
+            output = os.path.join(work_dir, '%s-%s.jsonl' % (name, mode))
+            runs = [run_one(args.show_call, src_dir, path, options, output)
+                    for _ in range(args.repeat)]
+            seconds = min(r[0] for r in runs)
+            rss = max(r[1] for r in runs)
+            calls = runs[0][2]
+            results.append({
+                'input': name,
+                'mode': mode,
+                'call_sites': calls,
+                'seconds': seconds,
+                'call_sites_per_sec': calls / seconds if seconds else 0,
+                'peak_rss_kb': rss,
+            })
+            print('%-12s %-14s %8d calls %8.3f s %10.0f calls/s %8d KB' %
+                  (name, mode, calls, seconds,
+                   results[-1]['call_sites_per_sec'], rss))
+
+    with open(args.output, 'w') as f:
+        json.dump({'show_call': args.show_call, 'scale': args.scale,
+                   'date': time.strftime('%Y-%m-%dT%H:%M:%S'),
+                   'results': results}, f, indent=2)
+
+    if args.baseline and compare(results, args.baseline, args.tolerance):
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,66 @@
+// Answer queries on a show-call output written with --format=binary
+//
+//  Usage:
+//  show-call-query <calls.scb> --callee-name=<name>...
+//  show-call-query <calls.scb> --list-callees
+//
+//  The file is mapped rather than read, and a query only looks at the
+//  callee table and at the records of the call sites it prints, whatever
+//  the size of the file.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "BinaryOutput.h"
+
+using namespace clang::showcall;
+using namespace llvm;
+
+namespace {
+cl::opt<std::string> InputFile(
+  cl::Positional,
+  cl::desc("<calls.scb>"),
+  cl::Required);
+
+cl::list<std::string> CalleeNames(
+  "callee-name",
+  cl::desc("Print the call sites of the functions of this name, unqualified "
+           "or (partially) qualified; may be repeated"),
+  cl::value_desc("name"),
+  cl::ZeroOrMore);
+
+cl::opt<bool> ListCallees(
+  "list-callees",
+  cl::desc("Print every callee, with its number of call sites"),
+  cl::init(false));
+} // end anonymous namespace
+
+int main(int argc, const char **argv) {
+  llvm::sys::PrintStackTraceOnErrorSignal();
+  cl::ParseCommandLineOptions(argc, argv);
+
+  std::string Error;
+  std::unique_ptr<BinaryCallFile> File = BinaryCallFile::open(InputFile, Error);
+  if (!File)
+    llvm::report_fatal_error("Cannot open " + InputFile + ": " + Error);
+
+  raw_ostream &OS = llvm::outs();
+  if (ListCallees)
+    for (uint32_t I = 0, E = File->getNumCallees(); I != E; ++I)
+      OS << File->getNumCallSites(I) << '\t' << File->getCalleeDescription(I)
+         << '\n';
+
+  for (const std::string &Name : CalleeNames) {
+    for (uint32_t Callee : File->findCallees(Name)) {
+      StringRef Description = File->getCalleeDescription(Callee);
+      for (const BinaryCallFile::Site &S : File->getCallSites(Callee))
+        OS << S.FileName << ':' << S.Line << ':' << S.Column << ": "
+           << S.Kind << " call to " << Description << '\n';
+    }
+  }
+  return 0;
+}
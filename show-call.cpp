@@ -20,29 +20,61 @@
 //  source tree, use:
 //
 //    /path/in/subtree $ find . -name '*.cpp'|
-//        xargs show-call /path/to/build
+//        xargs show-call -j 8 /path/to/build
+//
+//  where -j sets how many of the files are processed concurrently.
 //
 //===----------------------------------------------------------------------===//
 
-#include "clang/AST/ASTContext.h"
-#include "clang/ASTMatchers/ASTMatchers.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
 #include "clang/Basic/Diagnostic.h"
 #include "clang/Basic/SourceManager.h"
+#include "clang/Frontend/CompilerInstance.h"
 #include "clang/Frontend/FrontendActions.h"
-#include "clang/Lex/Lexer.h"
 #include "clang/Tooling/CompilationDatabase.h"
 #include "clang/Tooling/Refactoring.h"
 #include "clang/Tooling/Tooling.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/Signals.h"
 
-#include <sstream>
+#include "ASTDump.h"
+#include "Annotations.h"
+#include "CallCollector.h"
+#include "CallFilter.h"
+#include "CallIndex.h"
+#include "CallRecord.h"
+#include "CallSummary.h"
+#include "ChangedFiles.h"
+#include "CompileCommandsIndex.h"
+#include "Diff.h"
+#include "FileCache.h"
+#include "OutputPipeline.h"
+#include "OutputWriter.h"
+#include "Preamble.h"
+#include "Runner.h"
+#include "Sample.h"
+#include "Server.h"
+#include "Shard.h"
+#include "Stats.h"
+#include "Watch.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
 
 using namespace clang;
 using namespace clang::ast_matchers;
 using namespace clang::tooling;
+using namespace clang::showcall;
 using namespace llvm;
 
 // Set up the command line options
@@ -53,18 +85,66 @@ cl::opt<std::string> BuildPath(
 cl::list<std::string> SourcePaths(
   cl::Positional,
   cl::desc("<source0> [... <sourceN>]"),
-  cl::OneOrMore);
+  cl::ZeroOrMore);
 
 cl::opt<unsigned> CallAtLine(
   "call-at-line",
   cl::desc("Only display call(s) at this line"),
   cl::init(0));
 
-cl::opt<std::string> CalleeName(
+cl::opt<std::string> QueriesFile(
+  "queries",
+  cl::desc("Only display the calls at the <source>:<line> locations listed "
+           "in this file, one per line; each source file is parsed once"),
+  cl::value_desc("filename"),
+  cl::init(""));
+
+cl::list<std::string> CalleeNames(
   "callee-name",
-  cl::desc("Only display call(s) to this callee"),
+  cl::desc("Only display call(s) to this callee (may be repeated)"),
+  cl::ZeroOrMore);
+
+cl::opt<std::string> CalleeNamesFile(
+  "callee-names-file",
+  cl::desc("Only display call(s) to the callees listed in this file, one "
+           "per line"),
+  cl::value_desc("filename"),
+  cl::init(""));
+
+cl::opt<std::string> CalleeRegex(
+  "callee-regex",
+  cl::desc("Only display call(s) to the callees whose qualified name "
+           "matches this regular expression"),
+  cl::value_desc("regex"),
   cl::init(""));
 
+cl::opt<bool> MainFileOnly(
+  "main-file-only",
+  cl::desc("Only display the calls in the source files themselves, not in "
+           "their includes"),
+  cl::init(false));
+
+enum InstantiationMode { IM_All, IM_Skip, IM_Group };
+
+cl::opt<InstantiationMode> Instantiations(
+  "instantiations",
+  cl::desc("How to report the calls in template instantiations"),
+  cl::values(
+    clEnumValN(IM_All, "all", "Once per instantiation (default)"),
+    clEnumValN(IM_Skip, "skip", "Not at all: only the calls as written, "
+                                "outside of implicit code, whose callee does "
+                                "not depend on template parameters"),
+    clEnumValN(IM_Group, "group", "Once per call as written, with the "
+                                  "callees of all its instantiations"),
+    clEnumValEnd),
+  cl::init(IM_All));
+
+cl::opt<bool> DedupHeaders(
+  "dedup-headers",
+  cl::desc("Display the calls in included files only once, whatever the "
+           "number of source files including them"),
+  cl::init(false));
+
 cl::opt<bool> ShowCallAST(
   "show-call-ast",
   cl::desc("Display the AST at the call location"),
@@ -75,156 +155,1254 @@ cl::opt<bool> ShowCalleeAST(
   cl::desc("Display the callee declaration AST"),
   cl::init(false));
 
+cl::opt<std::string> ASTDumpFileName(
+  "ast-dump-file",
+  cl::desc("Write the AST dumps to this file instead of the output"),
+  cl::value_desc("filename"),
+  cl::init(""));
+
+cl::opt<ASTDumpFile::Format> ASTDumpFormat(
+  "ast-dump-format",
+  cl::desc("Format of --ast-dump-file"),
+  cl::values(
+    clEnumValN(ASTDumpFile::ADF_Text, "text", "The dumps as is (default)"),
+    clEnumValN(ASTDumpFile::ADF_JSON, "json",
+               "One JSON object per dump, with the dump as a string"),
+    clEnumValEnd),
+  cl::init(ASTDumpFile::ADF_Text));
+
+cl::opt<unsigned> ASTDumpDepth(
+  "ast-dump-depth",
+  cl::desc("Leave the nodes deeper than this out of the AST dumps "
+           "(0: no limit)"),
+  cl::value_desc("N"),
+  cl::init(0));
+
+cl::opt<unsigned> ASTDumpSize(
+  "ast-dump-size",
+  cl::desc("Cut each AST dump after this many kilobytes (0: no limit)"),
+  cl::value_desc("KB"),
+  cl::init(0));
+
 cl::opt<bool> Annotate(
   "annotate",
   cl::desc("Annotate the source code"),
   cl::init(false));
 
+cl::opt<std::string> AnnotateDir(
+  "annotate-dir",
+  cl::desc("With --annotate, write the annotated files under this directory, "
+           "with their absolute path, instead of changing the sources"),
+  cl::value_desc("directory"),
+  cl::init(""));
+
+cl::opt<std::string> OutputFile(
+  "o",
+  cl::desc("Write the results to this file instead of stdout"),
+  cl::value_desc("filename"),
+  cl::init("-"));
+
+cl::opt<OutputFormat> Format(
+  "format",
+  cl::desc("Output format"),
+  cl::values(
+    clEnumValN(OF_Text, "text", "Human readable text (default)"),
+    clEnumValN(OF_JSONLines, "jsonl", "One JSON object per line"),
+    clEnumValN(OF_CSV, "csv", "Comma separated values"),
+    clEnumValN(OF_Binary, "binary",
+               "Compact and indexed, for show-call-query"),
+    clEnumValEnd),
+  cl::init(OF_Text));
+
+cl::opt<unsigned> Jobs(
+  "j",
+  cl::desc("Number of files to process in parallel (0: one per core)"),
+  cl::value_desc("N"),
+  cl::init(1));
+
+cl::opt<bool> OutputThread(
+  "output-thread",
+  cl::desc("Format and write the call sites on a thread of their own, while "
+           "the next files are parsed (use --output-thread=false to disable)"),
+  cl::init(true));
+
+cl::opt<bool> FileCache(
+  "file-cache",
+  cl::desc("Look up and read each header once per run, instead of once per "
+           "source file including it (use --file-cache=false to disable)"),
+  cl::init(true));
+
+cl::opt<bool> LowMemory(
+  "low-memory",
+  cl::desc("Keep nothing of a file in memory once it is processed: headers "
+           "are then read again for each source file including them"),
+  cl::init(false));
+
+cl::opt<unsigned> MaxRSS(
+  "max-rss",
+  cl::desc("With -j, start no new file while show-call uses more than this "
+           "much resident memory, unless no other file is in progress"),
+  cl::value_desc("megabytes"),
+  cl::init(0));
+
+cl::opt<bool> Isolate(
+  "isolate",
+  cl::desc("Process the files in -j worker processes, so that a crash or a "
+           "hang only loses the file it happened on"),
+  cl::init(false));
+
+cl::opt<unsigned> WorkerTimeout(
+  "worker-timeout",
+  cl::desc("With --isolate, kill the worker of a file still in progress "
+           "after this long (0: no limit)"),
+  cl::value_desc("seconds"),
+  cl::init(0));
+
+cl::opt<unsigned> WorkerRetries(
+  "worker-retries",
+  cl::desc("With --isolate, how many more times to try a file whose worker "
+           "crashed or timed out"),
+  cl::value_desc("N"),
+  cl::init(1));
+
+cl::opt<std::string> TimingsFile(
+  "timings-file",
+  cl::desc("With -j, start the files which took the longest in earlier runs "
+           "first, and record the times of this run in this file"),
+  cl::value_desc("filename"),
+  cl::init(""));
+
+cl::opt<std::string> CompdbIndex(
+  "compdb-index",
+  cl::desc("Keep a binary index of compile_commands.json in this file, and "
+           "load the database from it while the JSON file is unchanged"),
+  cl::value_desc("filename"),
+  cl::init(""));
+
+cl::opt<std::string> IndexDir(
+  "index-dir",
+  cl::desc("Keep the call sites of each file in this directory, and answer "
+           "queries from there while the file and its includes are unchanged"),
+  cl::value_desc("directory"),
+  cl::init(""));
+
+cl::opt<std::string> PCHDir(
+  "pch-dir",
+  cl::desc("Precompile the leading #include block of the source files once "
+           "per set of compile flags, keep the precompiled headers in this "
+           "directory and reuse them across files and runs"),
+  cl::value_desc("directory"),
+  cl::init(""));
+
+cl::opt<bool> Summary(
+  "summary",
+  cl::desc("Instead of the call sites, print how many times each callee is "
+           "called, by which callers and from which files"),
+  cl::init(false));
+
+cl::opt<unsigned> SummaryTop(
+  "summary-top",
+  cl::desc("Number of callees, and of callers and files per callee, printed "
+           "by --summary (0: all)"),
+  cl::value_desc("K"),
+  cl::init(20));
+
+cl::opt<double> SampleFraction(
+  "sample",
+  cl::desc("Only process this fraction of the source files (all the files "
+           "of the compilation database if none is given), chosen at random; "
+           "--summary then estimates the counts over all of them"),
+  cl::value_desc("fraction"),
+  cl::init(0));
+
+cl::opt<unsigned> SampleFiles(
+  "sample-files",
+  cl::desc("Like --sample, but with the number of files to process"),
+  cl::value_desc("N"),
+  cl::init(0));
+
+cl::opt<unsigned> SampleSeed(
+  "sample-seed",
+  cl::desc("Seed of the random choice of --sample and --sample-files: the "
+           "same seed picks the same files"),
+  cl::value_desc("N"),
+  cl::init(0));
+
+cl::opt<std::string> ChangedFilesList(
+  "changed-files",
+  cl::desc("With --index-dir, only parse again the source files depending on "
+           "one of the files listed in this file, one per line, and take the "
+           "results of all other files from the index"),
+  cl::value_desc("filename"),
+  cl::init(""));
+
+cl::opt<std::string> ChangedSince(
+  "changed-since",
+  cl::desc("Same as --changed-files, with the files reported by "
+           "'git diff --name-only <revisions>'"),
+  cl::value_desc("revisions"),
+  cl::init(""));
+
+cl::opt<bool> ShowStats(
+  "stats",
+  cl::desc("Print the time spent in each phase, per file and in total, the "
+           "number of matches and the peak memory use to stderr"),
+  cl::init(false));
+
+cl::opt<std::string> StatsTrace(
+  "stats-trace",
+  cl::desc("Write the time spent on each file as a Chrome trace"),
+  cl::value_desc("filename"),
+  cl::init(""));
+
+cl::opt<std::string> Shard(
+  "shard",
+  cl::desc("Only process the K-th of N shards of the source files (all the "
+           "files of the compilation database if none is given), and write a "
+           "partial result for --merge"),
+  cl::value_desc("K/N"),
+  cl::init(""));
+
+cl::opt<bool> Merge(
+  "merge",
+  cl::desc("Combine the partial results of all the shards, given instead of "
+           "the build path and source files, into the output of a single run"),
+  cl::init(false));
+
+cl::opt<bool> Server(
+  "server",
+  cl::desc("Answer queries read from stdin, keeping the parsed files in "
+           "memory (the source paths are parsed up front)"),
+  cl::init(false));
+
+cl::opt<bool> Watch(
+  "watch",
+  cl::desc("Keep running: parse the files again when they or their headers "
+           "change, and print the call sites whose callee changed"),
+  cl::init(false));
+
+cl::opt<bool> WatchPoll(
+  "watch-poll",
+  cl::desc("With --watch, check the files every half second instead of "
+           "relying on inotify, e.g. on network file systems"),
+  cl::init(false));
+
+cl::opt<unsigned> WatchDelay(
+  "watch-delay",
+  cl::desc("With --watch, wait for this long without changes before parsing "
+           "the files again"),
+  cl::value_desc("milliseconds"),
+  cl::init(300));
+
+cl::opt<bool> Diff(
+  "diff",
+  cl::desc("Parse each file under two configurations, given as \"-- <flags> "
+           "-- <other flags>\" or with --diff-args, and only print the call "
+           "sites whose callees differ"),
+  cl::init(false));
+
+cl::opt<std::string> DiffArgs(
+  "diff-args",
+  cl::desc("With --diff, the second configuration is the compile command of "
+           "each file with these space separated flags appended"),
+  cl::value_desc("flags"),
+  cl::init(""));
+
 namespace {
-void getSourceInfo(const SourceManager &SM, const SourceLocation &Loc,
-                   StringRef &filename, unsigned &line, unsigned &col) {
-  std::pair<FileID, unsigned> LocInfo = SM.getDecomposedLoc(Loc);
-  FileID FID = LocInfo.first;
-  unsigned FileOffset = LocInfo.second;
-  filename = SM.getFilename(Loc);
-  line = SM.getLineNumber(FID, FileOffset);
-  col = SM.getColumnNumber(FID, FileOffset);
+// Makes FileName absolute against Directory, the directory of the compile
+// command which gave the record.
+void makeAbsoluteIn(StringRef Directory, StringRef FileName,
+                    SmallVectorImpl<char> &Path) {
+  Path.clear();
+  if (!FileName.empty() && !sys::path::is_absolute(FileName) &&
+      !Directory.empty())
+    Path.append(Directory.begin(), Directory.end());
+  sys::path::append(Path, FileName);
 }
 
-void getSourceInfo(const SourceManager &SM, const SourceLocation &Loc,
-                   StringRef &filename, unsigned &line) {
-  std::pair<FileID, unsigned> LocInfo = SM.getDecomposedLoc(Loc);
-  FileID FID = LocInfo.first;
-  unsigned FileOffset = LocInfo.second;
-  filename = SM.getFilename(Loc);
-  line = SM.getLineNumber(FID, FileOffset);
+// The --dedup-headers check of a record read back from the index or a
+// partial result, its file names being relative to Directory.
+bool insertHeaderCall(CallSiteSet &SeenHeaderCalls, StringRef Directory,
+                      const CallRecord &Record) {
+  SmallString<256> FileName, ExpansionFileName;
+  makeAbsoluteIn(Directory, Record.FileName, FileName);
+  makeAbsoluteIn(Directory, Record.ExpansionFileName, ExpansionFileName);
+  return SeenHeaderCalls.insert(FileName, Record.Offset, ExpansionFileName,
+                                Record.ExpansionOffset);
 }
 
-class SCCallBack : public MatchFinder::MatchCallback {
+// Runs the matchers, and records which files the translation unit read.
+class IndexingAction : public ASTFrontendAction {
 public:
-  SCCallBack(Replacements &Replace) : Replace(Replace) { }
+  IndexingAction(MatchFinder &Finder, std::vector<IndexDependency> &Deps)
+      : Finder(Finder), Deps(Deps) { }
+
+protected:
+  std::unique_ptr<ASTConsumer> CreateASTConsumer(CompilerInstance &CI,
+                                                 StringRef InFile) override {
+    return Finder.newASTConsumer();
+  }
+
+  void EndSourceFileAction() override {
+    collectDependencies(getCompilerInstance().getSourceManager(), Deps);
+  }
+
+private:
+  MatchFinder &Finder;
+  std::vector<IndexDependency> &Deps;
+};
 
-  virtual void run(const MatchFinder::MatchResult &Result) {
-    const SourceManager &SM = *Result.SourceManager;
-    const LangOptions &LangOpts = Result.Context->getLangOpts();
+class IndexingActionFactory : public FrontendActionFactory {
+public:
+  IndexingActionFactory(MatchFinder &Finder,
+                        std::vector<IndexDependency> &Deps)
+      : Finder(Finder), Deps(Deps) { }
 
-    if (const CallExpr *call =
-            Result.Nodes.getNodeAs<CallExpr>("call")) {
+  FrontendAction *create() override { return new IndexingAction(Finder, Deps); }
 
-      const char *callKind = "Function";
+private:
+  MatchFinder &Finder;
+  std::vector<IndexDependency> &Deps;
+};
 
-      if (isa<CXXMemberCallExpr>(call))
-        callKind = "Member";
-      else if (isa<CXXOperatorCallExpr>(call))
-        callKind = "Operator";
+// Answers the query for SourcePath from the index, after bringing its entry
+// up to date if needed. The index holds every call of the file, whatever the
+// query, so that the next one can be answered from it too.
+bool processWithIndex(const CallIndex &Index,
+                      const CompilationDatabase &Compilations,
+                      StringRef SourcePath, const CallFilter &Filter,
+                      const CallBackOptions &Options,
+                      const SCCallBack::RecordSink &Sink,
+                      vfs::FileSystem *FS) {
+  std::string File(getAbsolutePath(SourcePath));
+  std::vector<CompileCommand> Commands = Compilations.getCompileCommands(File);
+  if (Commands.empty()) {
+    llvm::errs() << "Skipping " << File << ". Compile command not found.\n";
+    return false;
+  }
 
-      dumpCallInfo(callKind, SM, call, LangOpts);
+  bool Success = true;
+  std::vector<CallRecord> Records;
+  if (!Index.lookup(Commands, Records)) {
+    Records.clear();
+    CallFilter All;
+    CallBackOptions IndexOptions;
+    IndexOptions.Stats = Options.Stats;
+    IndexOptions.FindCaller = true;
+    ast_matchers::MatchFinder Finder;
+    SCCallBack Callback(All, [&](const CallRecord &Record) {
+      Records.push_back(Record);
+    }, IndexOptions);
+    addCallMatcher(Finder, Callback, All);
 
-      return;
+    std::vector<IndexDependency> Deps;
+    IndexingActionFactory Factory(Finder, Deps);
+    for (const CompileCommand &Command : Commands) {
+      if (!runOnCompileCommand(Command, Factory, FS)) {
+        llvm::errs() << "Error while processing " << File << ".\n";
+        Success = false;
+      }
     }
 
-    assert(false && "Unhandled match !");
+    // Do not keep the results of a failed parse around.
+    if (Success && !Index.store(Commands, Deps, Records))
+      llvm::errs() << "warning: could not update the index entry for "
+                   << File << ".\n";
   }
 
-private:
-  Replacements &Replace;
+  StatsTimer Timer(Options.Stats, SP_Output);
+  for (const CallRecord &Record : Records) {
+    if (!Filter.matches(Record))
+      continue;
+    if (Options.SeenHeaderCalls && !Record.InMainFile &&
+        !insertHeaderCall(*Options.SeenHeaderCalls,
+                          Commands.front().Directory, Record))
+      continue;
+    Sink(Record);
+  }
+  return Success;
+}
 
-  void dumpCallInfo(const char *CallKind, const SourceManager &SM,
-                    const CallExpr *call, const LangOptions &LangOpts) {
+// Runs the matchers on SourcePath, only looking at the parts of the file
+// which may hold the calls accepted by Filter. The preamble of the file comes
+// from Preambles, if not null.
+bool processFile(const CompilationDatabase &Compilations, StringRef SourcePath,
+                 const CallFilter &Filter, const CallBackOptions &Options,
+                 const SCCallBack::RecordSink &Sink, vfs::FileSystem *FS,
+                 PreambleCache *Preambles) {
+  SCCallBack Callback(Filter, Sink, Options);
+  return collectCalls(Compilations, SourcePath, Filter, Callback, FS,
+                      Preambles);
+}
 
-    StringRef FileName;
-    unsigned LineNum, ColNum;
-    getSourceInfo(SM, call->getLocStart(), FileName, LineNum, ColNum);
+// Adds the names listed in FileName to Filter. Blank lines and lines
+// starting with '#' are ignored.
+void addCalleeNamesFromFile(CallFilter &Filter, StringRef FileName) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> Buffer =
+      MemoryBuffer::getFile(FileName);
+  if (!Buffer)
+    llvm::report_fatal_error("Cannot open " + FileName + ": " +
+                             Buffer.getError().message());
 
-    if (LineNum != CallAtLine && CallAtLine != 0)
-      return;
+  StringRef Line, Rest = (*Buffer)->getBuffer();
+  while (!Rest.empty()) {
+    std::tie(Line, Rest) = Rest.split('\n');
+    Line = Line.trim();
+    if (!Line.empty() && !Line.startswith("#"))
+      Filter.addCalleeName(Line);
+  }
+}
 
-    errs() << "Call site: "
-           << Lexer::getSourceText(
-                  CharSourceRange::getTokenRange(call->getSourceRange()), SM,
-                  LangOpts)
-           << " @ " << FileName << ':' << LineNum
-           << '\n';
+// Reads the "<source>:<line>" queries listed in FileName, and gives each
+// source file a copy of Base accepting its lines of the main file. Paths are
+// made absolute, and the new source files appended to them, so that each is
+// parsed once whatever the number of its queries, and whether it is also
+// given on the command line.
+void loadQueries(StringRef FileName, const CallFilter &Base,
+                 std::vector<std::string> &Paths,
+                 std::map<std::string, CallFilter> &Filters) {
+  std::set<std::string> Known;
+  for (std::string &Path : Paths) {
+    Path = getAbsolutePath(Path);
+    Known.insert(Path);
+  }
 
-    if (ShowCallAST)
-      call->dump();
+  ErrorOr<std::unique_ptr<MemoryBuffer>> Buffer =
+      MemoryBuffer::getFile(FileName);
+  if (!Buffer)
+    llvm::report_fatal_error("Cannot open " + FileName + ": " +
+                             Buffer.getError().message());
 
-    errs() << "Callee: ";
-    const FunctionDecl *CalleeDecl = cast<FunctionDecl>(call->getCalleeDecl());
+  StringRef Line, Rest = (*Buffer)->getBuffer();
+  while (!Rest.empty()) {
+    std::tie(Line, Rest) = Rest.split('\n');
+    Line = Line.trim();
+    if (Line.empty() || Line.startswith("#"))
+      continue;
+    StringRef Path, LineNumber;
+    std::tie(Path, LineNumber) = Line.rsplit(':');
+    unsigned N;
+    if (Path.empty() || LineNumber.getAsInteger(10, N) || N == 0) {
+      llvm::errs() << "warning: ignoring invalid query '" << Line << "'.\n";
+      continue;
+    }
 
-    SplitQualType T_split = CalleeDecl->getType().split();
-    std::ostringstream s;
+    std::string File(getAbsolutePath(Path));
+    std::map<std::string, CallFilter>::iterator I = Filters.find(File);
+    if (I == Filters.end()) {
+      I = Filters.insert(std::make_pair(File, Base)).first;
+      I->second.setMainFileOnly(true);
+      if (Known.insert(File).second)
+        Paths.push_back(File);
+    }
+    I->second.addLine(N);
+  }
+}
 
-    if (!CalleeDecl->isDefaulted()) {
-      StringRef DeclFileName;
-      unsigned DeclLineNum;
-      getSourceInfo(SM, CalleeDecl->getLocStart(), DeclFileName, DeclLineNum);
+// Prints partial results the way a single run over their files would have:
+// in the order they are added, deduplicating the header calls across them,
+// and summarizing or annotating at the end.
+class PartialMerger {
+public:
+  explicit PartialMerger(raw_ostream &Out)
+      : Out(Out), Writer(OutputWriter::create(Format, Out)), Result(0) {}
 
-      SplitQualType T_split = CalleeDecl->getType().split();
-      s << CalleeDecl->getQualifiedNameAsString()
-        << ' ' << QualType::getAsString(T_split)
-        << " @ " << DeclFileName.str() << ':' << DeclLineNum;
-    } else
-      s << "(defaulted) " << QualType::getAsString(T_split);
+  void writeHeader() {
+    if (!Summary)
+      Writer->writeHeader();
+  }
 
-    errs() << s.str() << '\n';
+  // Tells that the files are a sample, see CallSummary::setSampled.
+  void setSampled(size_t Population) { AllSummary.setSampled(Population); }
 
-    if (Annotate) {
-      char c = *FullSourceLoc(call->getLocEnd(), SM).getCharacterData();
-      std::string annotation(1, c);
-      annotation += " /* ";
-      annotation += s.str();
-      annotation += " */";
-      CharSourceRange InsertPt = CharSourceRange::getTokenRange(
-          call->getLocEnd(), call->getLocEnd());
-      Replace.insert(Replacement(SM, InsertPt, annotation));
+  void add(const PartialFileResult &File) {
+    if (!File.Success)
+      Result = 1;
+    CallSummary FileSummary;
+    for (const CallRecord &Record : File.Records) {
+      if (DedupHeaders && !Record.InMainFile &&
+          !insertHeaderCall(SeenHeaderCalls, File.Directory, Record))
+        continue;
+      if (Summary)
+        FileSummary.add(Record);
+      else
+        Writer->write(Record);
     }
+    if (Summary)
+      AllSummary.merge(FileSummary);
+    for (const Replacement &R : File.Replacements)
+      AllReplacements.insert(R);
+  }
 
-    if (ShowCalleeAST)
-      CalleeDecl->dump();
+  // Returns the exit code of the run.
+  int finish() {
+    if (Summary)
+      AllSummary.print(Out, SummaryTop);
+    else
+      Writer->writeFooter();
+    Out.flush();
 
-    errs() << '\n';
+    if (Annotate && Result == 0)
+      Result = saveAnnotations(AllReplacements, AnnotateDir, Jobs) ? 0 : 1;
+    return Result;
   }
 
+private:
+  raw_ostream &Out;
+  std::unique_ptr<OutputWriter> Writer;
+  int Result;
+  CallSiteSet SeenHeaderCalls;
+  CallSummary AllSummary;
+  AnnotationSet AllReplacements;
 };
+
+// The --watch loop: parses Paths, then again the ones affected by each burst
+// of changes to the files they read, and prints the call sites which are new
+// or whose callee changed since the last parse. Never returns.
+int watchSourcePaths(const CompilationDatabase &Compilations,
+                     ArrayRef<std::string> Paths, const CallFilter &Filter,
+                     const std::map<std::string, CallFilter> &QueryFilters,
+                     const CallBackOptions &Options, raw_ostream &Out) {
+  FileWatcher Watcher(WatchPoll, /*PollInterval=*/500);
+  CallSiteHistory History;
+  std::unique_ptr<OutputWriter> Writer = OutputWriter::create(Format, Out);
+  Writer->writeHeader();
+
+  // The calls of a header, and the dumps of the callees, are reported again
+  // should a file including them be parsed again.
+  CallBackOptions WatchOptions = Options;
+  WatchOptions.SeenHeaderCalls = nullptr;
+  WatchOptions.ClaimedCallees = nullptr;
+  WatchOptions.FindCaller = true;
+  WatchOptions.NeedCallText = true;
+
+  std::vector<std::string> AbsolutePaths;
+  for (const std::string &Path : Paths)
+    AbsolutePaths.push_back(getAbsolutePath(Path));
+  // The files each translation unit read the last time it was parsed.
+  std::vector<std::vector<std::string>> Dependencies(Paths.size());
+  std::vector<bool> Dirty(Paths.size(), true);
+  size_t Consumed = 0;
+
+  for (unsigned Pass = 1;; ++Pass) {
+    std::vector<size_t> Todo;
+    std::vector<std::string> TodoPaths;
+    for (size_t I = 0, E = Paths.size(); I != E; ++I) {
+      if (Dirty[I]) {
+        Todo.push_back(I);
+        TodoPaths.push_back(Paths[I]);
+      }
+    }
+
+    struct FileResult {
+      bool Done;
+      bool Success;
+      std::vector<CallRecord> Records;
+      std::vector<std::string> Files;
+      std::map<std::string, FileState> States;
+
+      FileResult() : Done(false), Success(false) {}
+    };
+    std::vector<FileResult> Results(Todo.size());
+
+    // Files change from one pass to the next, not during a pass.
+    IntrusiveRefCntPtr<vfs::FileSystem> FS = vfs::getRealFileSystem();
+    if (FileCache)
+      FS = new CachingFileSystem(FS, /*CacheContents=*/!LowMemory);
+
+    raw_null_ostream NullOut;
+    runOnSourcePaths(TodoPaths, Jobs, [&](size_t Index, StringRef SourcePath,
+                                          raw_ostream &) {
+      // Files changed since the pass started: the next pass starts over with
+      // the files left.
+      size_t Start = Watcher.getNumChanges();
+      if (Start != Consumed)
+        return true;
+
+      std::map<std::string, CallFilter>::const_iterator Query =
+          QueryFilters.find(getAbsolutePath(SourcePath));
+      const CallFilter &FileFilter =
+          Query != QueryFilters.end() ? Query->second : Filter;
+      FileResult &Result = Results[Index];
+      IntrusiveRefCntPtr<RecordingFileSystem> Recorder(
+          new RecordingFileSystem(FS));
+      Result.Success = processFile(
+          Compilations, SourcePath, FileFilter, WatchOptions,
+          [&](const CallRecord &Record) { Result.Records.push_back(Record); },
+          Recorder.get(), /*Preambles=*/nullptr);
+      Result.Files = Recorder->getFiles();
+      Result.States = Recorder->getStates();
+
+      // What was parsed of a file changing meanwhile is already stale.
+      for (const std::string &File :
+           Watcher.getChanges(Start, Watcher.getNumChanges()))
+        if (std::binary_search(Result.Files.begin(), Result.Files.end(),
+                               File))
+          return true;
+      Result.Done = true;
+      return Result.Success;
+    }, NullOut);
+
+    // A header call is printed once, whatever the number of files parsed
+    // again which include it.
+    std::set<std::string> Printed;
+    size_t Parsed = 0;
+    // The files as they were read. Of two translation units reading a file
+    // before and after a change, the first one is stale: the older state is
+    // kept, so that the watcher sees the change.
+    std::map<std::string, FileState> ReadStates;
+    for (size_t K = 0, E = Todo.size(); K != E; ++K) {
+      FileResult &Result = Results[K];
+      size_t I = Todo[K];
+      if (!Result.Done)
+        continue;
+      Dirty[I] = false;
+      ++Parsed;
+      for (const auto &File : Result.States) {
+        auto Known = ReadStates.insert(File);
+        if (!Known.second && File.second.ModTime < Known.first->second.ModTime)
+          Known.first->second = File.second;
+      }
+      if (!Result.Files.empty())
+        Dependencies[I].swap(Result.Files);
+      // Typically in the middle of an edit: the parse must not make all the
+      // calls look new the next time.
+      if (!Result.Success) {
+        llvm::errs() << "warning: " << Paths[I] << " does not compile, "
+                     << "keeping its previous call sites.\n";
+        continue;
+      }
+      for (size_t Changed : History.update(AbsolutePaths[I], Result.Records)) {
+        const CallRecord &Record = Result.Records[Changed];
+        if (Printed.insert(Record.FileName + '\0' +
+                           std::to_string(Record.Offset) + '\0' +
+                           Record.getCalleeDescription()).second)
+          Writer->write(Record);
+      }
+    }
+    Out.flush();
+
+    // Watch the source files, and everything their translation units read.
+    std::map<std::string, std::vector<size_t>> Dependents;
+    for (size_t I = 0, E = Paths.size(); I != E; ++I) {
+      Dependents[AbsolutePaths[I]].push_back(I);
+      for (const std::string &File : Dependencies[I])
+        if (File != AbsolutePaths[I])
+          Dependents[File].push_back(I);
+    }
+    std::vector<std::string> Watched;
+    for (const auto &File : Dependents)
+      Watched.push_back(File.first);
+    Watcher.setFiles(Watched, ReadStates);
+    llvm::errs() << "show-call: pass " << Pass << ": parsed " << Parsed
+                 << " files, printed " << Printed.size()
+                 << " call sites, watching " << Watched.size() << " files"
+                 << (Watcher.isPolling() ? " by polling" : "") << ".\n";
+
+    size_t End = Watcher.waitForChanges(Consumed, WatchDelay);
+    for (const std::string &File : Watcher.getChanges(Consumed, End)) {
+      std::map<std::string, std::vector<size_t>>::const_iterator Affected =
+          Dependents.find(File);
+      if (Affected != Dependents.end())
+        for (size_t I : Affected->second)
+          Dirty[I] = true;
+    }
+    Consumed = End;
+  }
+}
+
+// The --diff mode: parses each of Paths under both CompilationsA and
+// CompilationsB, at the same time on two threads sharing the file cache, and
+// prints the call sites whose callees differ.
+int diffSourcePaths(const CompilationDatabase &CompilationsA,
+                    const CompilationDatabase &CompilationsB,
+                    ArrayRef<std::string> Paths, const CallFilter &Filter,
+                    const std::map<std::string, CallFilter> &QueryFilters,
+                    const CallBackOptions &Options, vfs::FileSystem *FS,
+                    raw_ostream &Out) {
+  // Both configurations see the same header calls: they are compared in
+  // each file, and only the differences are deduplicated.
+  CallBackOptions DiffOptions = Options;
+  DiffOptions.SeenHeaderCalls = nullptr;
+  DiffOptions.ShowCallAST = false;
+  DiffOptions.ShowCalleeAST = false;
+  DiffOptions.NeedCallText = true;
+  DiffOptions.NeedLineColumn = true;
+  CallSiteSet SeenHeaderCalls;
+
+  return runOnSourcePaths(Paths, Jobs, [&](size_t, StringRef SourcePath,
+                                           raw_ostream &OS) {
+    std::map<std::string, CallFilter>::const_iterator Query =
+        QueryFilters.find(getAbsolutePath(SourcePath));
+    const CallFilter &FileFilter =
+        Query != QueryFilters.end() ? Query->second : Filter;
+
+    std::vector<CallRecord> RecordsB;
+    bool SuccessB = false;
+    std::thread ThreadB([&] {
+      SuccessB = processFile(
+          CompilationsB, SourcePath, FileFilter, DiffOptions,
+          [&](const CallRecord &Record) { RecordsB.push_back(Record); }, FS,
+          /*Preambles=*/nullptr);
+    });
+    std::vector<CallRecord> RecordsA;
+    bool SuccessA = processFile(
+        CompilationsA, SourcePath, FileFilter, DiffOptions,
+        [&](const CallRecord &Record) { RecordsA.push_back(Record); }, FS,
+        /*Preambles=*/nullptr);
+    ThreadB.join();
+    // A file failing to compile in one configuration would look like all
+    // its calls went away.
+    if (!SuccessA || !SuccessB)
+      return false;
+
+    std::vector<CompileCommand> Commands =
+        CompilationsA.getCompileCommands(getAbsolutePath(SourcePath));
+    writeCallDiff(RecordsA, RecordsB, Format, [&](const CallRecord &Record) {
+      if (!DedupHeaders || Record.InMainFile)
+        return true;
+      return insertHeaderCall(SeenHeaderCalls,
+                              Commands.empty() ? StringRef()
+                                               : Commands.front().Directory,
+                              Record);
+    }, OS);
+    return true;
+  }, Out);
+}
+
+// With --diff, "-- <flags> -- <other flags>" gives the two configurations:
+// removes the second group from argv, for loadFromCommandLine to see the
+// first one only, and returns it in Flags. Returns false if --diff is not
+// given, or there is no second group. This runs before the options are
+// parsed, so --diff is looked for among the arguments before the first "--".
+bool splitDiffFlags(int &argc, const char **argv,
+                    std::vector<std::string> &Flags) {
+  int First = 1;
+  bool HasDiff = false;
+  for (; First < argc && StringRef(argv[First]) != "--"; ++First) {
+    StringRef Arg(argv[First]);
+    if (Arg == "--diff" || Arg == "-diff" || Arg == "--diff=true" ||
+        Arg == "-diff=true")
+      HasDiff = true;
+    else if (Arg == "--diff=false" || Arg == "-diff=false")
+      HasDiff = false;
+  }
+  if (!HasDiff)
+    return false;
+  int Second = First + 1;
+  while (Second < argc && StringRef(argv[Second]) != "--")
+    ++Second;
+  if (Second >= argc)
+    return false;
+  Flags.assign(argv + Second + 1, argv + argc);
+  argc = Second;
+  return true;
+}
+
+// Prints the partial results of a sharded run the way a single run over all
+// the files would have.
+int mergeShards(ArrayRef<std::string> FileNames) {
+  if (FileNames.empty())
+    llvm::report_fatal_error("--merge needs the partial result files.");
+  PartialResults Results;
+  std::string Error;
+  for (const std::string &FileName : FileNames)
+    if (!Results.read(FileName, Error))
+      llvm::report_fatal_error("Cannot read " + FileName + ": " + Error);
+  if (!Results.finish(Error))
+    llvm::report_fatal_error("Cannot merge the shards: " + Error);
+
+  std::error_code EC;
+  raw_fd_ostream Out(OutputFile, EC,
+                     Format == OF_Binary ? sys::fs::F_None : sys::fs::F_Text);
+  if (EC)
+    llvm::report_fatal_error("Cannot open " + OutputFile + ": " +
+                             EC.message());
+  Out.SetBufferSize(1 << 16);
+
+  PartialMerger Merger(Out);
+  Merger.writeHeader();
+  for (const PartialFileResult &File : Results.getFiles())
+    Merger.add(File);
+  return Merger.finish();
+}
 } // end anonymous namespace
 
 int main(int argc, const char **argv) {
   llvm::sys::PrintStackTraceOnErrorSignal();
 
+  std::vector<std::string> DiffFlags;
+  bool HasDiffFlags = splitDiffFlags(argc, argv, DiffFlags);
+
+  PhaseTime DatabaseStart = PhaseTime::now();
   std::unique_ptr<CompilationDatabase> Compilations(
       FixedCompilationDatabase::loadFromCommandLine(argc, argv));
+  PhaseTime DatabaseTime = PhaseTime::now() - DatabaseStart;
 
   cl::ParseCommandLineOptions(argc, argv);
 
+  if (Merge) {
+    std::vector<std::string> PartialFiles;
+    if (!BuildPath.empty())
+      PartialFiles.push_back(BuildPath);
+    PartialFiles.insert(PartialFiles.end(), SourcePaths.begin(),
+                        SourcePaths.end());
+    return mergeShards(PartialFiles);
+  }
+
+  ShardSpec ThisShard;
+  if (!Shard.empty()) {
+    std::string Error;
+    if (!parseShardSpec(Shard, ThisShard, Error))
+      llvm::report_fatal_error("Invalid --shard: " + Error);
+  }
+
+  CallFilter Filter(CallAtLine, MainFileOnly);
+  Filter.setSkipInstantiations(Instantiations == IM_Skip);
+  for (const std::string &Name : CalleeNames)
+    Filter.addCalleeName(Name);
+  if (!CalleeNamesFile.empty())
+    addCalleeNamesFromFile(Filter, CalleeNamesFile);
+  if (!CalleeRegex.empty()) {
+    std::string Error;
+    if (!Filter.setCalleeRegex(CalleeRegex, Error))
+      llvm::report_fatal_error("Invalid --callee-regex: " + Error);
+  }
+
+  // The files named by --queries come with their own filter.
+  std::vector<std::string> Paths(SourcePaths.begin(), SourcePaths.end());
+  std::map<std::string, CallFilter> QueryFilters;
+  if (!QueriesFile.empty()) {
+    // Each query gives its own line.
+    if (CallAtLine)
+      llvm::report_fatal_error("--queries cannot be combined with "
+                               "--call-at-line.");
+    loadQueries(QueriesFile, Filter, Paths, QueryFilters);
+  }
+
   if (!Compilations) { // Couldn't find a compilation DB from the command line
     std::string ErrorMessage;
-    Compilations.reset(!BuildPath.empty()
-                           ? CompilationDatabase::autoDetectFromDirectory(
-                                 BuildPath, ErrorMessage)
-                           : CompilationDatabase::autoDetectFromSource(
-                                 SourcePaths[0], ErrorMessage));
+    if (BuildPath.empty() && Paths.empty())
+      llvm::report_fatal_error("No build path nor source file given.");
+    DatabaseStart = PhaseTime::now();
+    if (!CompdbIndex.empty()) {
+      std::string JSONPath =
+          !BuildPath.empty()
+              ? findJSONCompilationDatabase(BuildPath, /*SearchParents=*/false)
+              : findJSONCompilationDatabase(
+                    sys::path::parent_path(getAbsolutePath(Paths[0])),
+                    /*SearchParents=*/true);
+      if (!JSONPath.empty())
+        Compilations = IndexedCompilationDatabase::load(JSONPath, CompdbIndex,
+                                                        ErrorMessage);
+    }
+    if (!Compilations)
+      Compilations.reset(!BuildPath.empty()
+                             ? CompilationDatabase::autoDetectFromDirectory(
+                                   BuildPath, ErrorMessage)
+                             : CompilationDatabase::autoDetectFromSource(
+                                   Paths[0], ErrorMessage));
+    DatabaseTime += PhaseTime::now() - DatabaseStart;
 
     //  Still no compilation DB? - bail.
     if (!Compilations)
       llvm::report_fatal_error(ErrorMessage);
   }
 
-  RefactoringTool Tool(*Compilations, SourcePaths);
-  ast_matchers::MatchFinder Finder;
-  SCCallBack Callback(Tool.getReplacements());
+  // A sample of the files stands for all of them.
+  size_t Population = 0;
+  if (SampleFraction != 0 || SampleFiles != 0) {
+    if (!Shard.empty())
+      llvm::report_fatal_error("--shard cannot be combined with a sample.");
+    if (SampleFraction != 0 && SampleFiles != 0)
+      llvm::report_fatal_error("--sample and --sample-files are exclusive.");
+    if (SampleFraction < 0 || SampleFraction > 1)
+      llvm::report_fatal_error("--sample expects a fraction between 0 and 1.");
+    if (Paths.empty())
+      Paths = Compilations->getAllFiles();
+    Population = Paths.size();
+    size_t Count = SampleFiles != 0
+                       ? size_t(SampleFiles)
+                       : size_t(std::ceil(SampleFraction * Population));
+    // Confidence intervals need the spread between two files at least.
+    Count = std::max<size_t>(Count, 2);
+    std::vector<std::string> SamplePaths;
+    for (size_t Position : selectSample(Paths, Count, SampleSeed))
+      SamplePaths.push_back(Paths[Position]);
+    Paths.swap(SamplePaths);
+  }
+
+  // Shards, and the workers of --isolate, hand their results over as partial
+  // results instead of printing them.
+  bool KeepPartial = !Shard.empty() || Isolate;
+
+  // Every shard sees the same paths, and keeps its share of them. Results
+  // remember the position of their path in the whole run, for --merge.
+  std::vector<size_t> ShardPositions;
+  size_t NumRunPaths = 0;
+  if (!Shard.empty()) {
+    if (Paths.empty())
+      Paths = Compilations->getAllFiles();
+    NumRunPaths = Paths.size();
+    ShardPositions = selectShard(Paths, ThisShard);
+    std::vector<std::string> ShardPaths;
+    for (size_t Position : ShardPositions)
+      ShardPaths.push_back(Paths[Position]);
+    Paths.swap(ShardPaths);
+    if (ShowCallAST || ShowCalleeAST)
+      llvm::errs() << "warning: the AST dumps are not kept in the partial "
+                      "results of --shard.\n";
+  }
+
+  std::error_code EC;
+  raw_fd_ostream Out(OutputFile, EC,
+                     Format == OF_Binary ? sys::fs::F_None : sys::fs::F_Text);
+  if (EC)
+    llvm::report_fatal_error("Cannot open " + OutputFile + ": " +
+                             EC.message());
+  // Records are small and numerous: only hit the output a block at a time.
+  Out.SetBufferSize(1 << 16);
+
+  CallBackOptions Options;
+  Options.ShowCallAST = ShowCallAST;
+  Options.ShowCalleeAST = ShowCalleeAST;
+  Options.DumpLimits.MaxDepth = ASTDumpDepth;
+  Options.DumpLimits.MaxSize = size_t(ASTDumpSize) * 1024;
+  DumpedCallees ClaimedCallees;
+  if (ShowCalleeAST)
+    Options.ClaimedCallees = &ClaimedCallees;
+  // The merge of the shards may be asked for a summary.
+  Options.FindCaller = Summary || !Shard.empty();
+  Options.GroupInstantiations = Instantiations == IM_Group;
+  CallSiteSet SeenHeaderCalls;
+  if (DedupHeaders)
+    Options.SeenHeaderCalls = &SeenHeaderCalls;
+
+  // The second configuration of --diff: a second group of flags after "--",
+  // or the compile commands of the first one with --diff-args appended.
+  std::unique_ptr<CompilationDatabase> DiffCompilations;
+  if (!Diff && !DiffArgs.empty())
+    llvm::report_fatal_error("--diff-args is only used with --diff.");
+  if (Diff && !HasDiffFlags && DiffArgs.empty())
+    llvm::report_fatal_error("--diff needs a second group of flags after "
+                             "\"--\", or --diff-args.");
+  if (HasDiffFlags && !DiffArgs.empty())
+    llvm::report_fatal_error("--diff-args cannot be combined with a second "
+                             "group of flags after \"--\".");
+  if (HasDiffFlags) {
+    DiffCompilations.reset(new FixedCompilationDatabase(".", DiffFlags));
+  } else if (!DiffArgs.empty()) {
+    SmallVector<StringRef, 8> Extra;
+    StringRef(DiffArgs).split(Extra, " ", /*MaxSplit=*/-1,
+                              /*KeepEmpty=*/false);
+    DiffCompilations.reset(new ExtraArgsCompilationDatabase(
+        *Compilations, std::vector<std::string>(Extra.begin(), Extra.end())));
+  }
+  if (DiffCompilations) {
+    if (!Shard.empty() || Isolate || Summary || Annotate || Server || Watch)
+      llvm::report_fatal_error("A diff cannot be combined with --shard, "
+                               "--isolate, --summary, --annotate, --server "
+                               "nor --watch.");
+    if (Format != OF_Text && Format != OF_JSONLines)
+      llvm::report_fatal_error("A diff is only written in --format=text and "
+                               "--format=jsonl.");
+    if (!IndexDir.empty() || !PCHDir.empty() || ShowCallAST ||
+        ShowCalleeAST)
+      llvm::errs() << "warning: --index-dir, --pch-dir and the AST dumps are "
+                      "ignored in a diff.\n";
+    if (Paths.empty())
+      Paths = Compilations->getAllFiles();
+    IntrusiveRefCntPtr<vfs::FileSystem> FS;
+    if (FileCache)
+      FS = new CachingFileSystem(vfs::getRealFileSystem(),
+                                 /*CacheContents=*/!LowMemory);
+    return diffSourcePaths(*Compilations, *DiffCompilations, Paths, Filter,
+                           QueryFilters, Options, FS.get(), Out);
+  }
+
+  if (Server) {
+    if (Isolate)
+      llvm::report_fatal_error("--server cannot --isolate the files.");
+    if (Format == OF_Binary)
+      llvm::report_fatal_error("--server cannot answer in --format=binary.");
+    CallServer S(*Compilations, Format, Options);
+    for (const std::string &SourcePath : SourcePaths)
+      S.preload(SourcePath);
+    S.serve(std::cin, Out);
+    return 0;
+  }
+
+  // Only extract what the output shows: a summary needs neither the text
+  // nor the position of the calls, the binary format no text. The partial
+  // results of a shard may be merged into any format.
+  Options.NeedCallText = !Shard.empty() || (!Summary && Format != OF_Binary);
+  Options.NeedLineColumn = !Shard.empty() || !Summary;
+
+  if (Watch) {
+    if (!Shard.empty() || Isolate || Summary || Annotate ||
+        Format == OF_Binary)
+      llvm::report_fatal_error("--watch cannot be combined with --shard, "
+                               "--isolate, --summary, --annotate nor "
+                               "--format=binary.");
+    if (!IndexDir.empty() || !PCHDir.empty() || !ASTDumpFileName.empty())
+      llvm::errs() << "warning: --index-dir, --pch-dir and --ast-dump-file "
+                      "are ignored with --watch.\n";
+    if (Paths.empty())
+      Paths = Compilations->getAllFiles();
+    return watchSourcePaths(*Compilations, Paths, Filter, QueryFilters,
+                            Options, Out);
+  }
+
+  // The dumps go to a file of their own, shared by all the workers.
+  std::unique_ptr<raw_fd_ostream> DumpOut;
+  std::unique_ptr<ASTDumpFile> ASTDumps;
+  if (Isolate && (ShowCallAST || ShowCalleeAST))
+    llvm::errs() << "warning: the AST dumps are not kept with --isolate.\n";
+  else if (!ASTDumpFileName.empty() && (ShowCallAST || ShowCalleeAST)) {
+    DumpOut.reset(new raw_fd_ostream(ASTDumpFileName, EC, sys::fs::F_Text));
+    if (EC)
+      llvm::report_fatal_error("Cannot open " + ASTDumpFileName + ": " +
+                               EC.message());
+    DumpOut->SetBufferSize(1 << 16);
+    ASTDumps.reset(new ASTDumpFile(*DumpOut, ASTDumpFormat));
+    Options.ASTDumps = ASTDumps.get();
+  }
+
+  if (!Shard.empty())
+    writePartialHeader(Out, ThisShard, NumRunPaths);
+  else if (!Summary && !Isolate)
+    OutputWriter::create(Format, Out)->writeHeader();
+
+  // The index only keeps the records, the AST is needed for the rest.
+  std::unique_ptr<CallIndex> Index;
+  if (!IndexDir.empty()) {
+    if (ShowCallAST || ShowCalleeAST || Annotate || Instantiations != IM_All)
+      llvm::errs() << "warning: --index-dir is ignored with --show-call-ast, "
+                      "--show-callee-ast, --annotate and --instantiations.\n";
+    else
+      Index.reset(new CallIndex(IndexDir));
+  }
+
+  // Incremental mode: trust the entries which depend on no changed file.
+  if (!ChangedFilesList.empty() || !ChangedSince.empty()) {
+    if (IndexDir.empty())
+      llvm::report_fatal_error(
+          "--changed-files and --changed-since require --index-dir.");
+    std::vector<std::string> Changed;
+    std::string Error;
+    if ((!ChangedFilesList.empty() &&
+         !readChangedFiles(ChangedFilesList, Changed, Error)) ||
+        (!ChangedSince.empty() &&
+         !getGitChangedFiles(ChangedSince, Changed, Error)))
+      llvm::report_fatal_error("Cannot get the changed files: " + Error);
+    if (Index)
+      Index->setChangedFiles(Changed);
+  }
+
+  // The index records the includes of each file from its AST, which the
+  // precompiled preamble would hide.
+  std::unique_ptr<PreambleCache> Preambles;
+  if (!PCHDir.empty()) {
+    if (Index)
+      llvm::errs() << "warning: --pch-dir is ignored with --index-dir.\n";
+    else
+      Preambles.reset(new PreambleCache(PCHDir));
+  }
+
+  // The workers of --isolate would keep the statistics to themselves.
+  bool CollectStats = (ShowStats || !StatsTrace.empty()) && !Isolate;
+  if (Isolate && (ShowStats || !StatsTrace.empty()))
+    llvm::errs() << "warning: --stats and --stats-trace only report the "
+                    "totals with --isolate.\n";
+  RunStats Stats;
+  Stats.addGlobal("compilation db", DatabaseTime);
+
+  std::mutex ReplaceMutex;
+  AnnotationSet AllReplacements;
+  std::mutex SummaryMutex;
+  CallSummary AllSummary;
+  if (Population)
+    AllSummary.setSampled(Population);
+
+  // All files share the lookups and contents of the headers they include.
+  // Contents are what makes the cache big.
+  IntrusiveRefCntPtr<vfs::FileSystem> FS;
+  if (FileCache)
+    FS = new CachingFileSystem(vfs::getRealFileSystem(),
+                               /*CacheContents=*/!LowMemory);
+
+  // Start the biggest files first, so that they do not hold up the end of
+  // the run.
+  CostModel Costs;
+  if (!TimingsFile.empty() && !Costs.load(TimingsFile))
+    llvm::errs() << "warning: cannot read " << TimingsFile << ".\n";
+  std::vector<double> Times;
+
+  // The workers only queue their records, and go on with the next file
+  // while this thread formats and writes them. The binary format needs a
+  // single writer for the whole output.
+  std::unique_ptr<OutputWriter> PipelineWriter;
+  std::unique_ptr<OutputPipeline> Pipeline;
+  raw_null_ostream NullOut;
+  if ((OutputThread || Format == OF_Binary) && !Summary && !KeepPartial) {
+    PipelineWriter = OutputWriter::create(Format, Out);
+    Pipeline.reset(new OutputPipeline(*PipelineWriter, Out, Paths.size()));
+  }
+  raw_ostream &FileOut = Pipeline ? static_cast<raw_ostream &>(NullOut) : Out;
+
+  SourceProcessor Process = [&](size_t PathIndex, StringRef SourcePath,
+                                raw_ostream &OS) {
+    std::map<std::string, CallFilter>::const_iterator Query =
+        QueryFilters.find(getAbsolutePath(SourcePath));
+    const CallFilter &FileFilter =
+        Query != QueryFilters.end() ? Query->second : Filter;
+
+    // Each file gets its own callback and options, so that files can be
+    // processed concurrently.
+    TUStats FileStats(SourcePath);
+    AnnotationSet Replace;
+    CallBackOptions FileOptions = Options;
+    if (CollectStats)
+      FileOptions.Stats = &FileStats;
+    if (Annotate)
+      FileOptions.Annotations = &Replace;
+
+    // With --summary, records are only counted, and the counts of all
+    // files printed at the end. Partial results keep them for merging.
+    std::unique_ptr<OutputWriter> Writer = OutputWriter::create(Format, OS);
+    CallSummary FileSummary;
+    PartialFileResult Partial;
+    SCCallBack::RecordSink Sink = [&](const CallRecord &Record) {
+      if (Pipeline)
+        Pipeline->add(PathIndex, Record);
+      else if (KeepPartial)
+        Partial.Records.push_back(Record);
+      else if (Summary)
+        FileSummary.add(Record);
+      else
+        Writer->write(Record);
+    };
+
+    bool Success;
+    {
+      StatsTimer Timer(FileOptions.Stats, SP_Total);
+      Success = Index ? processWithIndex(*Index, *Compilations, SourcePath,
+                                         FileFilter, FileOptions, Sink,
+                                         FS.get())
+                      : processFile(*Compilations, SourcePath, FileFilter,
+                                    FileOptions, Sink, FS.get(),
+                                    Preambles.get());
+    }
+    if (Pipeline)
+      Pipeline->close(PathIndex);
+
+    if (CollectStats)
+      Stats.add(std::move(FileStats));
+    if (KeepPartial) {
+      Partial.Position =
+          Shard.empty() ? PathIndex : ShardPositions[PathIndex];
+      Partial.SourcePath = SourcePath;
+      std::vector<CompileCommand> Commands =
+          Compilations->getCompileCommands(getAbsolutePath(SourcePath));
+      if (!Commands.empty())
+        Partial.Directory = Commands.front().Directory;
+      Partial.Success = Success;
+      Partial.Replacements = Replace.getAllReplacements();
+      writePartialFileResult(OS, Partial);
+      return Success;
+    }
+    if (Summary) {
+      std::lock_guard<std::mutex> Lock(SummaryMutex);
+      AllSummary.merge(FileSummary);
+    }
+    if (Annotate) {
+      std::lock_guard<std::mutex> Lock(ReplaceMutex);
+      AllReplacements.merge(Replace);
+    }
+    return Success;
+  };
+
+  int Result = 0;
+  if (Isolate) {
+    // Only this thread may run while workers are forked. What they send back
+    // is merged here the way --merge does, or passed on by a shard.
+    PartialMerger Merger(Out);
+    if (Population)
+      Merger.setSampled(Population);
+    if (Shard.empty())
+      Merger.writeHeader();
+    WorkerPoolOptions PoolOptions;
+    PoolOptions.Workers = Jobs;
+    PoolOptions.Timeout = WorkerTimeout;
+    PoolOptions.Retries = WorkerRetries;
+    size_t NumPositions = Shard.empty() ? Paths.size() : NumRunPaths;
+    std::vector<size_t> Failed = runInWorkerProcesses(
+        Paths, PoolOptions,
+        [&](size_t Index, raw_ostream &OS) {
+          Process(Index, Paths[Index], OS);
+        },
+        [&](size_t Index, StringRef Results) {
+          std::vector<PartialFileResult> Files;
+          std::string Error;
+          if (!readPartialFileResults(Results, NumPositions, Files, Error)) {
+            llvm::errs() << "warning: invalid results for " << Paths[Index]
+                         << ": " << Error << ".\n";
+            Result = 1;
+            return;
+          }
+          for (const PartialFileResult &File : Files) {
+            if (!File.Success)
+              Result = 1;
+            if (Shard.empty())
+              Merger.add(File);
+          }
+          if (!Shard.empty())
+            Out << Results;
+        },
+        Costs.estimate(Paths), &Times);
+    if (Shard.empty() && Merger.finish() != 0)
+      Result = 1;
+
+    if (!Failed.empty()) {
+      llvm::errs() << "error: " << Failed.size() << " of " << Paths.size()
+                   << " files failed in their worker:\n";
+      for (size_t Index : Failed)
+        llvm::errs() << "  " << Paths[Index] << "\n";
+      Result = 1;
+    }
+  } else {
+    Result = runOnSourcePaths(Paths, Jobs, Process, FileOut,
+                              Costs.estimate(Paths), &Times,
+                              uint64_t(MaxRSS) << 20);
+  }
+  if (Pipeline) {
+    Pipeline->finish();
+    PipelineWriter->writeFooter();
+  }
+  if (Summary && !KeepPartial)
+    AllSummary.print(Out, SummaryTop);
+  Out.flush();
+
+  if (!TimingsFile.empty()) {
+    // Files which failed in their worker have no time.
+    for (size_t I = 0, E = Paths.size(); I != E; ++I)
+      if (Times[I] > 0)
+        Costs.record(Paths[I], Times[I]);
+    if (!Costs.save(TimingsFile))
+      llvm::errs() << "warning: cannot write " << TimingsFile << ".\n";
+  }
+
+  // Shards leave the annotations to --merge, and --isolate to its merger.
+  if (Annotate && !KeepPartial && Result == 0) {
+    PhaseTime SaveStart = PhaseTime::now();
+    Result = saveAnnotations(AllReplacements, AnnotateDir, Jobs) ? 0 : 1;
+    Stats.addGlobal("annotations", PhaseTime::now() - SaveStart);
+  }
 
-  if (CalleeName != "")
-    Finder.addMatcher(
-        callExpr(callee(functionDecl(hasName(CalleeName)))).bind("call"),
-        &Callback);
-  else
-    Finder.addMatcher(callExpr().bind("call"), &Callback);
-  //Finder.addMatcher(
-  //    memberCallExpr(on(hasType(asString("N::C *"))),
-  //                   callee(methodDecl(hasName("f")))).bind("call"),
-  //    &Callback);
+  if (ShowStats)
+    Stats.print(llvm::errs());
+  if (!StatsTrace.empty() && !Stats.writeTrace(StatsTrace))
+    Result = 1;
 
-  return Annotate ? Tool.runAndSave(newFrontendActionFactory(&Finder).get())
-                  : Tool.run(newFrontendActionFactory(&Finder).get());
+  return Result;
 }
@@ -0,0 +1,119 @@
+//===-- BinaryOutputTest.cpp - Tests for the binary output format ---------===//
+
+#include "BinaryOutput.h"
+#include "CallRecord.h"
+#include "OutputWriter.h"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+using namespace clang::showcall;
+
+namespace {
+
+CallRecord makeRecord(const char *Kind, const char *FileName, unsigned Line,
+                      const char *CalleeName, const char *CalleeType) {
+  CallRecord R;
+  R.Kind = Kind;
+  R.FileName = FileName;
+  R.Line = Line;
+  R.Column = 3;
+  R.InMainFile = true;
+  R.CalleeName = CalleeName;
+  R.CalleeType = CalleeType;
+  R.CalleeFileName = "a.h";
+  R.CalleeLine = 1;
+  return R;
+}
+
+class BinaryOutputTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    ASSERT_FALSE(llvm::sys::fs::createTemporaryFile("show-call-test", "bin",
+                                                    Path));
+  }
+
+  void TearDown() override { llvm::sys::fs::remove(Path); }
+
+  std::unique_ptr<BinaryCallFile> writeAndOpen(
+      const std::vector<CallRecord> &Records) {
+    {
+      std::error_code EC;
+      llvm::raw_fd_ostream OS(Path, EC, llvm::sys::fs::F_None);
+      EXPECT_FALSE(EC);
+      std::unique_ptr<OutputWriter> Writer = createBinaryWriter(OS);
+      Writer->writeHeader();
+      for (const CallRecord &R : Records)
+        Writer->write(R);
+      Writer->writeFooter();
+    }
+    std::string Error;
+    std::unique_ptr<BinaryCallFile> File = BinaryCallFile::open(Path, Error);
+    EXPECT_TRUE(File != nullptr) << Error;
+    return File;
+  }
+
+  llvm::SmallString<128> Path;
+};
+
+TEST_F(BinaryOutputTest, RoundTrip) {
+  std::vector<CallRecord> Records;
+  Records.push_back(makeRecord("Function", "x.cpp", 10, "N::f", "void (int)"));
+  Records.push_back(makeRecord("Member", "y.cpp", 20, "A::g", "void ()"));
+  Records.push_back(makeRecord("Function", "y.cpp", 30, "N::f", "void (int)"));
+  Records.push_back(makeRecord("Operator", "x.cpp", 40, "N::f",
+                               "void (double)"));
+  Records.back().InMainFile = false;
+  std::unique_ptr<BinaryCallFile> File = writeAndOpen(Records);
+  ASSERT_TRUE(File != nullptr);
+
+  EXPECT_EQ(4u, File->getNumRecords());
+  // The two overloads of N::f are distinct callees.
+  EXPECT_EQ(3u, File->getNumCallees());
+
+  std::vector<uint32_t> Callees = File->findCallees("N::f");
+  ASSERT_EQ(2u, Callees.size());
+  uint32_t F = Callees[0];
+  if (File->getCalleeDescription(F) != Records[0].getCalleeDescription())
+    F = Callees[1];
+  EXPECT_EQ("N::f", File->getCalleeName(F));
+  EXPECT_EQ(Records[0].getCalleeDescription(), File->getCalleeDescription(F));
+  EXPECT_EQ(2u, File->getNumCallSites(F));
+
+  std::vector<BinaryCallFile::Site> Sites = File->getCallSites(F);
+  ASSERT_EQ(2u, Sites.size());
+  EXPECT_EQ("x.cpp", Sites[0].FileName);
+  EXPECT_EQ(10u, Sites[0].Line);
+  EXPECT_EQ(3u, Sites[0].Column);
+  EXPECT_STREQ("Function", Sites[0].Kind);
+  EXPECT_TRUE(Sites[0].InMainFile);
+  EXPECT_FALSE(Sites[0].CalleeDefaulted);
+  EXPECT_EQ("y.cpp", Sites[1].FileName);
+  EXPECT_EQ(30u, Sites[1].Line);
+
+  // Unqualified and partially qualified names match too.
+  EXPECT_EQ(2u, File->findCallees("f").size());
+  EXPECT_EQ(1u, File->findCallees("g").size());
+  EXPECT_TRUE(File->findCallees("h").empty());
+
+  std::vector<uint32_t> G = File->findCallees("A::g");
+  ASSERT_EQ(1u, G.size());
+  Sites = File->getCallSites(G[0]);
+  ASSERT_EQ(1u, Sites.size());
+  EXPECT_STREQ("Member", Sites[0].Kind);
+}
+
+TEST_F(BinaryOutputTest, RejectsOtherFiles) {
+  {
+    std::error_code EC;
+    llvm::raw_fd_ostream OS(Path, EC, llvm::sys::fs::F_None);
+    OS << "Function\tf()\ttest.cpp\t1\t2\n";
+  }
+  std::string Error;
+  EXPECT_TRUE(BinaryCallFile::open(Path, Error) == nullptr);
+  EXPECT_FALSE(Error.empty());
+}
+
+} // end anonymous namespace
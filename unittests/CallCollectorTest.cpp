@@ -0,0 +1,90 @@
+//===-- CallCollectorTest.cpp - Tests for the call records of an AST ------===//
+
+#include "CallCollector.h"
+#include "CallFilter.h"
+#include "CallRecord.h"
+
+#include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "clang/Tooling/Tooling.h"
+#include "gtest/gtest.h"
+
+using namespace clang;
+using namespace clang::showcall;
+
+namespace {
+
+std::vector<CallRecord> collect(llvm::StringRef Code,
+                                bool GroupInstantiations) {
+  CallFilter Filter;
+  CallBackOptions Options;
+  Options.GroupInstantiations = GroupInstantiations;
+  std::vector<CallRecord> Records;
+  SCCallBack Callback(
+      Filter, [&](const CallRecord &R) { Records.push_back(R); }, Options);
+  ast_matchers::MatchFinder Finder;
+  addCallMatcher(Finder, Callback, Filter);
+  EXPECT_TRUE(tooling::runToolOnCode(
+      tooling::newFrontendActionFactory(&Finder)->create(), Code));
+  return Records;
+}
+
+const char TemplateCode[] = "void g(int);\n"
+                            "void g(double);\n"
+                            "template <class T> void t(T x) { g(x); }\n"
+                            "void u() { t(1); t(1.0); }\n";
+
+TEST(CallCollectorTest, ReportsEachInstantiation) {
+  std::vector<CallRecord> Records = collect(TemplateCode, false);
+  // t<int>, t<double>, and g in each instantiation: the call in the
+  // template itself has no callee yet.
+  EXPECT_EQ(4u, Records.size());
+}
+
+TEST(CallCollectorTest, GroupsInstantiations) {
+  std::vector<CallRecord> Records = collect(TemplateCode, true);
+  ASSERT_EQ(3u, Records.size());
+  unsigned Groups = 0;
+  for (const CallRecord &R : Records) {
+    if (R.CalleeName != "g") {
+      EXPECT_TRUE(R.InstantiationCallees.empty());
+      continue;
+    }
+    ++Groups;
+    ASSERT_EQ(1u, R.InstantiationCallees.size());
+    // Whichever instantiation comes first, the other callee is the other
+    // overload.
+    std::string Callees = R.CalleeType + ' ' + R.InstantiationCallees[0];
+    EXPECT_NE(std::string::npos, Callees.find("void (int)"));
+    EXPECT_NE(std::string::npos, Callees.find("void (double)"));
+  }
+  EXPECT_EQ(1u, Groups);
+}
+
+TEST(CallCollectorTest, KeepsChainedCallsApart) {
+  // b() and c() start at the same location.
+  std::vector<CallRecord> Records =
+      collect("struct A { A &b(); void c(); };\n"
+              "void f(A a) { a.b().c(); }\n",
+              true);
+  ASSERT_EQ(2u, Records.size());
+  EXPECT_EQ("A::c", Records[0].CalleeName);
+  EXPECT_EQ("A::b", Records[1].CalleeName);
+  for (const CallRecord &R : Records)
+    EXPECT_TRUE(R.InstantiationCallees.empty());
+}
+
+TEST(CallCollectorTest, KeepsNestedOperatorsApart) {
+  std::vector<CallRecord> Records =
+      collect("struct X {};\n"
+              "X operator+(const X &, const X &);\n"
+              "void f(X x, X y, X z) { x + y + z; }\n",
+              true);
+  ASSERT_EQ(2u, Records.size());
+  for (const CallRecord &R : Records) {
+    EXPECT_STREQ("Operator", R.Kind);
+    EXPECT_TRUE(R.InstantiationCallees.empty());
+  }
+  EXPECT_NE(Records[0].CallText, Records[1].CallText);
+}
+
+} // end anonymous namespace
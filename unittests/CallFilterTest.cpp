@@ -0,0 +1,30 @@
+//===-- CallFilterTest.cpp - Tests for the selection of the callees -------===//
+
+#include "CallFilter.h"
+
+#include "gtest/gtest.h"
+
+using namespace clang::showcall;
+
+namespace {
+
+TEST(CallFilterTest, MatchesNameSuffixes) {
+  CallFilter Filter;
+  Filter.addCalleeName("b::f");
+  EXPECT_TRUE(Filter.matchesCallee("b::f"));
+  EXPECT_TRUE(Filter.matchesCallee("a::b::f"));
+  EXPECT_FALSE(Filter.matchesCallee("ab::f"));
+  EXPECT_FALSE(Filter.matchesCallee("b::g"));
+  EXPECT_TRUE(Filter.mayMatchCallee("f"));
+  EXPECT_FALSE(Filter.mayMatchCallee("g"));
+}
+
+TEST(CallFilterTest, MatchesFullyQualifiedNames) {
+  CallFilter Filter;
+  Filter.addCalleeName("::b::f");
+  EXPECT_TRUE(Filter.matchesCallee("b::f"));
+  EXPECT_FALSE(Filter.matchesCallee("a::b::f"));
+  EXPECT_TRUE(Filter.mayMatchCallee("f"));
+}
+
+} // end anonymous namespace
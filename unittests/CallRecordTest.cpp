@@ -0,0 +1,85 @@
+//===-- CallRecordTest.cpp - Tests for the record serialization -----------===//
+
+#include "CallRecord.h"
+
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+using namespace clang::showcall;
+
+namespace {
+
+CallRecord makeRecord() {
+  CallRecord R;
+  R.Kind = "Member";
+  R.CallText = "a.f(\"\\t\")";
+  R.FileName = "dir/test.cpp";
+  R.Line = 12;
+  R.Column = 5;
+  R.Offset = 345;
+  R.InMainFile = false;
+  R.CallerName = "N::caller";
+  R.CalleeName = "A::f";
+  R.CalleeType = "void (const char *)";
+  R.CalleeFileName = "dir/a.h";
+  R.CalleeLine = 7;
+  return R;
+}
+
+CallRecord roundTrip(const CallRecord &R) {
+  std::string Line;
+  {
+    llvm::raw_string_ostream OS(Line);
+    serializeRecord(R, OS);
+  }
+  // One record, one line, whatever the fields hold.
+  EXPECT_EQ(Line.size() - 1, Line.find('\n'));
+  CallRecord Read;
+  EXPECT_TRUE(deserializeRecord(llvm::StringRef(Line).drop_back(), Read));
+  return Read;
+}
+
+void expectSameRecord(const CallRecord &Expected, const CallRecord &Actual) {
+  EXPECT_STREQ(Expected.Kind, Actual.Kind);
+  EXPECT_EQ(Expected.CallText, Actual.CallText);
+  EXPECT_EQ(Expected.FileName, Actual.FileName);
+  EXPECT_EQ(Expected.Line, Actual.Line);
+  EXPECT_EQ(Expected.Column, Actual.Column);
+  EXPECT_EQ(Expected.Offset, Actual.Offset);
+  EXPECT_EQ(Expected.ExpansionFileName, Actual.ExpansionFileName);
+  EXPECT_EQ(Expected.ExpansionOffset, Actual.ExpansionOffset);
+  EXPECT_EQ(Expected.InMainFile, Actual.InMainFile);
+  EXPECT_EQ(Expected.CallerName, Actual.CallerName);
+  EXPECT_EQ(Expected.CalleeName, Actual.CalleeName);
+  EXPECT_EQ(Expected.CalleeType, Actual.CalleeType);
+  EXPECT_EQ(Expected.CalleeFileName, Actual.CalleeFileName);
+  EXPECT_EQ(Expected.CalleeLine, Actual.CalleeLine);
+  EXPECT_EQ(Expected.CalleeDefaulted, Actual.CalleeDefaulted);
+  EXPECT_EQ(Expected.InstantiationCallees, Actual.InstantiationCallees);
+}
+
+TEST(CallRecordTest, RoundTrip) {
+  CallRecord R = makeRecord();
+  expectSameRecord(R, roundTrip(R));
+}
+
+TEST(CallRecordTest, RoundTripInstantiationCallees) {
+  CallRecord R = makeRecord();
+  R.InstantiationCallees.push_back("B::f void (int) @ dir/b.h:3");
+  R.InstantiationCallees.push_back("C::f void (\tdouble) @ dir/c.h:9");
+  expectSameRecord(R, roundTrip(R));
+}
+
+TEST(CallRecordTest, RoundTripExpansion) {
+  CallRecord R = makeRecord();
+  R.ExpansionFileName = "dir/use\t.cpp";
+  R.ExpansionOffset = 678;
+  expectSameRecord(R, roundTrip(R));
+}
+
+TEST(CallRecordTest, RejectsTruncatedLine) {
+  CallRecord R;
+  EXPECT_FALSE(deserializeRecord("Function\tf()\ttest.cpp\t1\t2", R));
+}
+
+} // end anonymous namespace
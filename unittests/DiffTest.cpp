@@ -0,0 +1,100 @@
+//===-- DiffTest.cpp - Tests for the comparison of two configurations -----===//
+
+#include "CallRecord.h"
+#include "Diff.h"
+
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+using namespace clang::showcall;
+
+namespace {
+
+CallRecord makeRecord(unsigned Offset, const char *CalleeType) {
+  CallRecord R;
+  R.Kind = "Function";
+  R.CallText = "f(x)";
+  R.FileName = "test.cpp";
+  R.Line = Offset / 10;
+  R.Column = 3;
+  R.Offset = Offset;
+  R.CallerName = "caller";
+  R.CalleeName = "f";
+  R.CalleeType = CalleeType;
+  R.CalleeFileName = "a.h";
+  R.CalleeLine = 1;
+  return R;
+}
+
+bool acceptAll(const CallRecord &) { return true; }
+
+std::string diff(const std::vector<CallRecord> &A,
+                 const std::vector<CallRecord> &B, OutputFormat Format,
+                 size_t ExpectedSites) {
+  std::string Out;
+  llvm::raw_string_ostream OS(Out);
+  EXPECT_EQ(ExpectedSites, writeCallDiff(A, B, Format, acceptAll, OS));
+  return OS.str();
+}
+
+TEST(DiffTest, SameCalleesAreNotWritten) {
+  std::vector<CallRecord> A = {makeRecord(10, "void (int)"),
+                               makeRecord(20, "void (long)")};
+  EXPECT_EQ("", diff(A, A, OF_Text, 0));
+}
+
+TEST(DiffTest, WritesChangedCallee) {
+  std::vector<CallRecord> A = {makeRecord(10, "void (int)"),
+                               makeRecord(20, "void (int)")};
+  std::vector<CallRecord> B = {makeRecord(10, "void (int)"),
+                               makeRecord(20, "void (long)")};
+  EXPECT_EQ("Call site: f(x) @ test.cpp:2\n"
+            "- Callee: " + A[1].getCalleeDescription() + "\n"
+            "+ Callee: " + B[1].getCalleeDescription() + "\n\n",
+            diff(A, B, OF_Text, 1));
+}
+
+TEST(DiffTest, WritesOneSidedCalls) {
+  std::vector<CallRecord> A = {makeRecord(10, "void (int)")};
+  std::vector<CallRecord> B = {makeRecord(20, "void (int)")};
+  std::string Callee = A[0].getCalleeDescription();
+  EXPECT_EQ("Call site: f(x) @ test.cpp:1\n"
+            "- Callee: " + Callee + "\n"
+            "+ No call\n\n"
+            "Call site: f(x) @ test.cpp:2\n"
+            "- No call\n"
+            "+ Callee: " + Callee + "\n\n",
+            diff(A, B, OF_Text, 2));
+}
+
+TEST(DiffTest, ComparesCalleesAsSets) {
+  // The calls of a macro expanded twice share their offset.
+  std::vector<CallRecord> A = {makeRecord(10, "void (int)"),
+                               makeRecord(10, "void (long)")};
+  std::vector<CallRecord> B = {makeRecord(10, "void (long)"),
+                               makeRecord(10, "void (int)"),
+                               makeRecord(10, "void (int)")};
+  EXPECT_EQ("", diff(A, B, OF_Text, 0));
+}
+
+TEST(DiffTest, AppliesFilter) {
+  std::vector<CallRecord> A = {makeRecord(10, "void (int)")};
+  std::vector<CallRecord> B = {makeRecord(10, "void (long)")};
+  std::string Out;
+  llvm::raw_string_ostream OS(Out);
+  EXPECT_EQ(0u, writeCallDiff(A, B, OF_Text,
+                              [](const CallRecord &) { return false; }, OS));
+  EXPECT_EQ("", OS.str());
+}
+
+TEST(DiffTest, WritesJSONLines) {
+  std::vector<CallRecord> A = {makeRecord(10, "void (int)")};
+  std::vector<CallRecord> B;
+  std::string Callee = A[0].getCalleeDescription();
+  EXPECT_EQ("{\"kind\":\"Function\",\"call\":\"f(x)\",\"file\":\"test.cpp\","
+            "\"line\":1,\"column\":3,\"callees_a\":[\"" + Callee + "\"],"
+            "\"callees_b\":[]}\n",
+            diff(A, B, OF_JSONLines, 1));
+}
+
+} // end anonymous namespace
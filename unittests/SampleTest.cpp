@@ -0,0 +1,116 @@
+//===-- SampleTest.cpp - Tests for the sampled runs -----------------------===//
+
+#include "CallRecord.h"
+#include "CallSummary.h"
+#include "Sample.h"
+
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+#include <algorithm>
+
+using namespace clang::showcall;
+
+namespace {
+
+std::vector<std::string> makePaths(unsigned Count) {
+  std::vector<std::string> Paths;
+  for (unsigned I = 0; I != Count; ++I)
+    Paths.push_back("dir/file" + std::to_string(I) + ".cpp");
+  return Paths;
+}
+
+std::vector<std::string> getSample(const std::vector<std::string> &Paths,
+                                   size_t Count, uint64_t Seed) {
+  std::vector<std::string> Sample;
+  for (size_t Position : selectSample(Paths, Count, Seed))
+    Sample.push_back(Paths[Position]);
+  std::sort(Sample.begin(), Sample.end());
+  return Sample;
+}
+
+TEST(SampleTest, SelectsDistinctPositionsInOrder) {
+  std::vector<std::string> Paths = makePaths(100);
+  std::vector<size_t> Positions = selectSample(Paths, 10, 1);
+  ASSERT_EQ(10u, Positions.size());
+  for (size_t I = 1; I != Positions.size(); ++I)
+    EXPECT_LT(Positions[I - 1], Positions[I]);
+  EXPECT_LT(Positions.back(), Paths.size());
+}
+
+TEST(SampleTest, KeepsEverythingWhenTooFew) {
+  std::vector<std::string> Paths = makePaths(5);
+  std::vector<size_t> Positions = selectSample(Paths, 10, 1);
+  std::vector<size_t> Expected = {0, 1, 2, 3, 4};
+  EXPECT_EQ(Expected, Positions);
+  EXPECT_TRUE(selectSample(Paths, 0, 1).empty());
+}
+
+TEST(SampleTest, DoesNotDependOnOrder) {
+  std::vector<std::string> Paths = makePaths(50);
+  std::vector<std::string> Reversed(Paths.rbegin(), Paths.rend());
+  EXPECT_EQ(getSample(Paths, 7, 42), getSample(Reversed, 7, 42));
+}
+
+TEST(SampleTest, BiggerSampleIncludesSmallerOne) {
+  std::vector<std::string> Paths = makePaths(50);
+  std::vector<std::string> Small = getSample(Paths, 5, 3);
+  std::vector<std::string> Big = getSample(Paths, 20, 3);
+  EXPECT_TRUE(std::includes(Big.begin(), Big.end(), Small.begin(),
+                            Small.end()));
+}
+
+TEST(SampleTest, DependsOnSeed) {
+  std::vector<std::string> Paths = makePaths(100);
+  EXPECT_NE(getSample(Paths, 10, 1), getSample(Paths, 10, 2));
+}
+
+CallRecord makeRecord(const std::string &FileName) {
+  CallRecord R;
+  R.Kind = "Function";
+  R.FileName = FileName;
+  R.CallerName = "caller";
+  R.CalleeName = "f";
+  R.CalleeType = "void ()";
+  R.CalleeFileName = "a.h";
+  R.CalleeLine = 1;
+  return R;
+}
+
+std::string printSummary(const CallSummary &Summary) {
+  std::string Out;
+  llvm::raw_string_ostream OS(Out);
+  Summary.print(OS, 1);
+  return OS.str();
+}
+
+TEST(SampleTest, EstimatesOverThePopulation) {
+  // Two sampled files out of four, with 1 and 3 calls: 8 calls are
+  // estimated, and the interval is 12.706 * 4 * sqrt((1 - 2 / 4) * 2 / 2).
+  CallSummary Total;
+  unsigned Calls[] = {1, 3};
+  for (unsigned I = 0; I != 2; ++I) {
+    CallSummary File;
+    for (unsigned J = 0; J != Calls[I]; ++J)
+      File.add(makeRecord("file" + std::to_string(I) + ".cpp"));
+    Total.merge(File);
+  }
+  Total.setSampled(4);
+  std::string Out = printSummary(Total);
+  EXPECT_NE(std::string::npos, Out.find("sampled 2 of 4 files: 4 calls"));
+  EXPECT_NE(std::string::npos, Out.find("         8 +- 36       calls\n"));
+}
+
+TEST(SampleTest, ExactWhenEveryFileIsSampled) {
+  CallSummary Total;
+  for (unsigned I = 0; I != 3; ++I) {
+    CallSummary File;
+    File.add(makeRecord("file" + std::to_string(I) + ".cpp"));
+    Total.merge(File);
+  }
+  Total.setSampled(3);
+  EXPECT_NE(std::string::npos,
+            printSummary(Total).find("         3 +- 0        calls\n"));
+}
+
+} // end anonymous namespace
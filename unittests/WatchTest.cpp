@@ -0,0 +1,82 @@
+//===-- WatchTest.cpp - Tests for the changes printed by --watch ----------===//
+
+#include "CallRecord.h"
+#include "Watch.h"
+
+#include "gtest/gtest.h"
+
+using namespace clang::showcall;
+
+namespace {
+
+CallRecord makeRecord(const char *CallText, unsigned Line,
+                      const char *CalleeName) {
+  CallRecord R;
+  R.Kind = "Function";
+  R.CallText = CallText;
+  R.FileName = "test.cpp";
+  R.Line = Line;
+  R.CallerName = "caller";
+  R.CalleeName = CalleeName;
+  R.CalleeType = "void ()";
+  return R;
+}
+
+TEST(CallSiteHistoryTest, FirstPassIsAllNew) {
+  CallSiteHistory History;
+  std::vector<CallRecord> Records = {makeRecord("f()", 1, "f"),
+                                     makeRecord("g()", 2, "g")};
+  std::vector<size_t> Expected = {0, 1};
+  EXPECT_EQ(Expected, History.update("test.cpp", Records));
+}
+
+TEST(CallSiteHistoryTest, UnchangedPassIsEmpty) {
+  CallSiteHistory History;
+  std::vector<CallRecord> Records = {makeRecord("f()", 1, "f")};
+  History.update("test.cpp", Records);
+  EXPECT_TRUE(History.update("test.cpp", Records).empty());
+}
+
+TEST(CallSiteHistoryTest, IgnoresMovedCalls) {
+  CallSiteHistory History;
+  std::vector<CallRecord> Records = {makeRecord("f()", 1, "f"),
+                                     makeRecord("g()", 2, "g")};
+  History.update("test.cpp", Records);
+  // Lines were inserted above the calls.
+  Records[0].Line = 11;
+  Records[1].Line = 12;
+  EXPECT_TRUE(History.update("test.cpp", Records).empty());
+}
+
+TEST(CallSiteHistoryTest, ReportsNewCallsAndChangedCallees) {
+  CallSiteHistory History;
+  std::vector<CallRecord> Records = {makeRecord("f(x)", 1, "f"),
+                                     makeRecord("g()", 2, "g")};
+  History.update("test.cpp", Records);
+  // An overload of f now wins, and a call to h was added.
+  Records[0].CalleeType = "void (int)";
+  Records.push_back(makeRecord("h()", 3, "h"));
+  std::vector<size_t> Expected = {0, 2};
+  EXPECT_EQ(Expected, History.update("test.cpp", Records));
+}
+
+TEST(CallSiteHistoryTest, TellsIdenticalCallsApart) {
+  CallSiteHistory History;
+  std::vector<CallRecord> Records = {makeRecord("f()", 1, "f")};
+  History.update("test.cpp", Records);
+  // The same call, a second time in the same function.
+  Records.push_back(makeRecord("f()", 2, "f"));
+  std::vector<size_t> Expected = {1};
+  EXPECT_EQ(Expected, History.update("test.cpp", Records));
+}
+
+TEST(CallSiteHistoryTest, KeepsSourcePathsApart) {
+  CallSiteHistory History;
+  std::vector<CallRecord> Records = {makeRecord("f()", 1, "f")};
+  History.update("a.cpp", Records);
+  // The header calls of another source file are new for it.
+  EXPECT_EQ(1u, History.update("b.cpp", Records).size());
+  EXPECT_TRUE(History.update("a.cpp", Records).empty());
+}
+
+} // end anonymous namespace